@@ -0,0 +1,133 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "benchmark/benchmark.h"
+#include "data/bindata.h"
+#include <utility>
+#include <vector>
+
+namespace veles {
+namespace data {
+
+static BinData makeData(size_t size) {
+  BinData res(8, size);
+  uint8_t *raw = res.rawData();
+  for (size_t i = 0; i < size; i++)
+    raw[i] = i * 0x5b;
+  return res;
+}
+
+static void BM_Construct(benchmark::State &state) {
+  size_t size = state.range(0);
+  while (state.KeepRunning())
+    benchmark::DoNotOptimize(BinData(8, size));
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+static void BM_ConstructFromRaw(benchmark::State &state) {
+  size_t size = state.range(0);
+  std::vector<uint8_t> raw(size, 0x5a);
+  while (state.KeepRunning())
+    benchmark::DoNotOptimize(BinData(8, size, raw.data()));
+  state.SetBytesProcessed(state.iterations() * size);
+}
+
+static void BM_Copy(benchmark::State &state) {
+  BinData data = makeData(state.range(0));
+  while (state.KeepRunning()) {
+    BinData copy(data);
+    benchmark::DoNotOptimize(copy);
+  }
+}
+
+static void BM_Move(benchmark::State &state) {
+  BinData data = makeData(state.range(0));
+  while (state.KeepRunning()) {
+    BinData moved(std::move(data));
+    data = std::move(moved);
+    benchmark::DoNotOptimize(data);
+  }
+}
+
+/** Copy followed by a write, which has to detach the shared storage.  */
+static void BM_CopyDetach(benchmark::State &state) {
+  BinData data = makeData(state.range(0));
+  while (state.KeepRunning()) {
+    BinData copy(data);
+    copy.setElement64(0, 1);
+    benchmark::DoNotOptimize(copy);
+  }
+  state.SetBytesProcessed(state.iterations() * data.octets());
+}
+
+static void BM_ToString(benchmark::State &state) {
+  unsigned width = state.range(0);
+  BinData data(width, state.range(1));
+  for (size_t i = 0; i < data.size(); i++)
+    data.setElement64(i, i * 0x9e3779b97f4a7c15ull);
+  while (state.KeepRunning())
+    benchmark::DoNotOptimize(data.toString(data.size()));
+  state.SetItemsProcessed(state.iterations() * data.size());
+  state.SetBytesProcessed(state.iterations() * data.octets());
+}
+
+static void BM_SumElement64(benchmark::State &state) {
+  BinData data = makeData(state.range(0));
+  while (state.KeepRunning()) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < data.size(); i++)
+      sum += data.element64(i);
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void BM_SumElements(benchmark::State &state) {
+  BinData data = makeData(state.range(0));
+  while (state.KeepRunning()) {
+    uint64_t sum = 0;
+    for (uint8_t x : data.elements<uint8_t>())
+      sum += x;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void BM_SumElementReader(benchmark::State &state) {
+  BinData data = makeData(state.range(0));
+  while (state.KeepRunning()) {
+    uint64_t sum = 0;
+    for (uint64_t x : data.elementReader())
+      sum += x;
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+BENCHMARK(BM_Construct)->Arg(1)->Arg(8)->Arg(4096)->Arg(1 << 20);
+BENCHMARK(BM_ConstructFromRaw)->Arg(1)->Arg(8)->Arg(4096)->Arg(1 << 20);
+BENCHMARK(BM_Copy)->Arg(1)->Arg(4096)->Arg(1 << 20);
+BENCHMARK(BM_Move)->Arg(1)->Arg(4096)->Arg(1 << 20);
+BENCHMARK(BM_CopyDetach)->Arg(4096)->Arg(1 << 20);
+BENCHMARK(BM_ToString)->ArgNames({"width", "elements"})
+  ->Args({8, 16})->Args({8, 4096})->Args({12, 4096})->Args({64, 4096})
+  ->Args({80, 1024});
+BENCHMARK(BM_SumElement64)->Arg(1 << 20);
+BENCHMARK(BM_SumElements)->Arg(1 << 20);
+BENCHMARK(BM_SumElementReader)->Arg(1 << 20);
+
+}
+}
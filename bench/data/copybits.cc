@@ -0,0 +1,50 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "benchmark/benchmark.h"
+#include "data/bindata.h"
+#include <vector>
+
+namespace veles {
+namespace data {
+
+static void BM_CopyBits(benchmark::State &state) {
+  unsigned dst_bit = state.range(0);
+  unsigned src_bit = state.range(1);
+  size_t octets = state.range(2);
+  std::vector<uint8_t> src(octets + 1, 0x5a);
+  std::vector<uint8_t> dst(octets + 1);
+  unsigned num_bits = octets * 8;
+  while (state.KeepRunning()) {
+    BinData::copyBits(dst.data(), dst_bit, src.data(), src_bit, num_bits);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * octets);
+}
+
+/** Every combination of source and destination bit alignment.  */
+static void CopyBitsArgs(benchmark::internal::Benchmark *bench) {
+  bench->ArgNames({"dst_bit", "src_bit", "octets"});
+  for (int dst_bit = 0; dst_bit < 8; dst_bit++)
+    for (int src_bit = 0; src_bit < 8; src_bit++)
+      for (int octets : {8, 4096, 1 << 20})
+        bench->Args({dst_bit, src_bit, octets});
+}
+
+BENCHMARK(BM_CopyBits)->Apply(CopyBitsArgs);
+
+}
+}
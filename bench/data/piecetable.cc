@@ -0,0 +1,62 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "benchmark/benchmark.h"
+#include "data/piecetable.h"
+#include <random>
+
+namespace veles {
+namespace data {
+
+/** Builds a 256 MiB table split into the given number of pieces by
+    scattered one-byte edits.  */
+static PieceTable scatteredTable(size_t num_edits) {
+  const uint64_t size = 0x10000000;
+  PieceTable table(BinData(8, size));
+  std::mt19937 gen(1);
+  for (size_t i = 0; i < num_edits; i++) {
+    uint64_t pos = gen() % size;
+    table.replace(pos, pos + 1, BinData(8, {0xaa}));
+  }
+  return table;
+}
+
+/** A single one-byte edit - the cost should grow with the logarithm of
+    the piece count, and not at all with the data size.  */
+static void BM_PieceTableReplace(benchmark::State &state) {
+  PieceTable table = scatteredTable(state.range(0));
+  std::mt19937 gen(2);
+  while (state.KeepRunning()) {
+    uint64_t pos = gen() % table.size();
+    table.replace(pos, pos + 1, BinData(8, {0x55}));
+  }
+  state.counters["pieces"] = table.pieceCount();
+}
+BENCHMARK(BM_PieceTableReplace)->Arg(0)->Arg(1000)->Arg(100000);
+
+/** Taking a snapshot of a range, the way data replies do.  */
+static void BM_PieceTableSlice(benchmark::State &state) {
+  PieceTable table = scatteredTable(state.range(0));
+  std::mt19937 gen(2);
+  while (state.KeepRunning()) {
+    uint64_t start = gen() % table.size();
+    benchmark::DoNotOptimize(table.slice(start, table.size()));
+  }
+}
+BENCHMARK(BM_PieceTableSlice)->Arg(0)->Arg(1000)->Arg(100000);
+
+}
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "benchmark/benchmark.h"
+#include "data/repack.h"
+
+namespace veles {
+namespace data {
+
+static void BM_Repack(benchmark::State &state, RepackEndian endian,
+                      unsigned low_pad, unsigned high_pad) {
+  RepackFormat format{endian, unsigned(state.range(0)), high_pad, low_pad};
+  size_t num_elements = state.range(1);
+  BinData src(8, repackSize(8, format, num_elements));
+  for (size_t i = 0; i < src.size(); i++)
+    src.setElement64(i, i * 0x5b);
+  while (state.KeepRunning())
+    benchmark::DoNotOptimize(repack(src, format, 0, num_elements));
+  state.SetItemsProcessed(state.iterations() * num_elements);
+  state.SetBytesProcessed(state.iterations() * src.octets());
+}
+
+static void RepackArgs(benchmark::internal::Benchmark *bench) {
+  bench->ArgNames({"width", "elements"});
+  for (int width : {1, 4, 8, 12, 16, 23, 24, 32, 64})
+    for (int num_elements : {1, 4096, 1 << 20})
+      bench->Args({width, num_elements});
+}
+
+BENCHMARK_CAPTURE(BM_Repack, little, RepackEndian::LITTLE, 0, 0)
+  ->Apply(RepackArgs);
+BENCHMARK_CAPTURE(BM_Repack, big, RepackEndian::BIG, 0, 0)
+  ->Apply(RepackArgs);
+BENCHMARK_CAPTURE(BM_Repack, little_padded, RepackEndian::LITTLE, 1, 8)
+  ->Apply(RepackArgs);
+BENCHMARK_CAPTURE(BM_Repack, big_padded, RepackEndian::BIG, 1, 8)
+  ->Apply(RepackArgs);
+
+/** Decodes a stream of 32-bit big-endian fields one at a time, the way
+    a parser reads them.  */
+static void BM_RepackFields(benchmark::State &state) {
+  size_t num_fields = state.range(0);
+  BinData src(8, num_fields * 4);
+  for (size_t i = 0; i < src.size(); i++)
+    src.setElement64(i, i * 0x5b);
+  RepackFormat format{RepackEndian::BIG, 32};
+  while (state.KeepRunning()) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < num_fields; i++)
+      sum += repack(src, format, i * 4, 1).element64();
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * num_fields);
+}
+
+static void BM_StaticRepackFields(benchmark::State &state) {
+  size_t num_fields = state.range(0);
+  BinData src(8, num_fields * 4);
+  for (size_t i = 0; i < src.size(); i++)
+    src.setElement64(i, i * 0x5b);
+  const BinData &csrc = src;
+  while (state.KeepRunning()) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < num_fields; i++)
+      sum += RepackBe32::decode(csrc.rawData(i * 4));
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * num_fields);
+}
+
+BENCHMARK(BM_RepackFields)->Arg(1 << 20);
+BENCHMARK(BM_StaticRepackFields)->Arg(1 << 20);
+
+}
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "util/parallel.h"
+#include "util/sampling/entropy.h"
+
+namespace veles {
+namespace util {
+
+static const size_t k_input_size = 256 << 20;
+static const size_t k_window = 256;
+static const size_t k_min_bytes_per_task = 64 * 1024;
+
+/** 256MB alternating between random, low-entropy and constant regions.  */
+static const std::vector<uint8_t> &input() {
+  static std::vector<uint8_t> data;
+  if (data.empty()) {
+    data.resize(k_input_size);
+    uint32_t state = 1;
+    for (size_t i = 0; i < data.size(); i++) {
+      state = state * 1103515245 + 12345;
+      uint8_t value = state >> 24;
+      switch (i >> 16 & 3) {
+      case 0: case 1: data[i] = value; break;
+      case 2: data[i] = value & 0x3; break;
+      default: data[i] = 0x42;
+      }
+    }
+  }
+  return data;
+}
+
+static float referenceEntropy(const uint64_t *counts, size_t count) {
+  float entropy = 0.0f;
+  for (int i = 0; i < 256; ++i) {
+    if (counts[i] > 0) {
+      float fcounts = static_cast<float>(counts[i]) / count;
+      entropy -= fcounts * log2(fcounts);
+    }
+  }
+  return entropy;
+}
+
+/** The per pixel minimap kernel before util::entropyPerPoint().  */
+static void referencePerPoint(const uint8_t *sample, size_t sample_size,
+                              size_t points, double point_size, float *out) {
+  uint64_t counts[256];
+  memset(counts, 0, sizeof(counts));
+  size_t index = 0, point_count = 0;
+  for (size_t i = 0; i < sample_size; ++i) {
+    counts[sample[i]] += 1;
+    point_count += 1;
+    if (static_cast<double>(i) / point_size >= index + 1) {
+      if (index == points - 1 && i < sample_size - 1) continue;
+      out[index] = referenceEntropy(counts, point_count);
+      index += 1;
+      point_count = 0;
+      memset(counts, 0, sizeof(counts));
+    }
+  }
+}
+
+/** The sliding window minimap kernel before
+    util::slidingEntropyPerPoint().  */
+static void referenceSliding(const uint8_t *sample, size_t sample_size,
+                             double point_size, float *out) {
+  uint64_t counts[256];
+  memset(counts, 0, sizeof(counts));
+  size_t start = 0, end = 0;
+  while (start < sample_size) {
+    size_t mid = (start + end) / 2;
+    if (mid > 0 && std::floor(mid / point_size) !=
+        std::floor((mid - 1) / point_size)) {
+      out[static_cast<size_t>(mid / point_size)] =
+          referenceEntropy(counts, end - start);
+    }
+    if (end > k_window || end >= sample_size) {
+      counts[sample[start++]] -= 1;
+    }
+    if (end < sample_size) {
+      counts[sample[end++]] += 1;
+    }
+  }
+}
+
+static void BM_EntropyPerPoint(benchmark::State &state, bool reference) {
+  const std::vector<uint8_t> &data = input();
+  double point_size = state.range(0);
+  size_t points = data.size() / state.range(0);
+  std::vector<float> out(points);
+  while (state.KeepRunning()) {
+    if (reference)
+      referencePerPoint(data.data(), data.size(), points, point_size,
+                        out.data());
+    else
+      entropyPerPoint(data.data(), data.size(), point_size, points,
+                      out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void BM_SlidingEntropy(benchmark::State &state, bool reference) {
+  const std::vector<uint8_t> &data = input();
+  double point_size = state.range(0);
+  std::vector<float> out(data.size() / state.range(0));
+  while (state.KeepRunning()) {
+    if (reference)
+      referenceSliding(data.data(), data.size(), point_size, out.data());
+    else
+      slidingEntropyPerPoint(data.data(), data.size(), point_size, k_window,
+                             out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+/** All minimap statistics at once, for comparison with a pass per
+    statistic.  */
+static void BM_StatsPerPoint(benchmark::State &state) {
+  const std::vector<uint8_t> &data = input();
+  double point_size = state.range(0);
+  size_t points = data.size() / state.range(0);
+  std::vector<ByteStats> out(points);
+  while (state.KeepRunning()) {
+    statsPerPoint(data.data(), data.size(), point_size, points, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void BM_SlidingStats(benchmark::State &state) {
+  const std::vector<uint8_t> &data = input();
+  double point_size = state.range(0);
+  size_t points = data.size() / state.range(0);
+  std::vector<ByteStats> out(points);
+  while (state.KeepRunning()) {
+    slidingStatsPerPoint(data.data(), data.size(), point_size, points,
+                         k_window, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+/** Points split between all cores, the way minimap textures are
+    computed.  */
+static void BM_EntropyPerPointParallel(benchmark::State &state) {
+  const std::vector<uint8_t> &data = input();
+  double point_size = state.range(0);
+  size_t points = data.size() / state.range(0);
+  std::vector<float> out(points);
+  while (state.KeepRunning()) {
+    parallelFor(points, k_min_bytes_per_task / state.range(0) + 1,
+                [&](size_t first, size_t last) {
+      entropyPerPoint(data.data(), data.size(), point_size, points,
+                      out.data(), first, last);
+    });
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+static void BM_SlidingEntropyParallel(benchmark::State &state) {
+  const std::vector<uint8_t> &data = input();
+  double point_size = state.range(0);
+  size_t points = data.size() / state.range(0);
+  std::vector<float> out(points);
+  while (state.KeepRunning()) {
+    parallelFor(points, k_min_bytes_per_task / state.range(0) + 1,
+                [&](size_t first, size_t last) {
+      slidingEntropyPerPoint(data.data(), data.size(), point_size, k_window,
+                             out.data(), first, last);
+    });
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+BENCHMARK_CAPTURE(BM_EntropyPerPoint, reference, true)
+  ->ArgName("point")->Arg(512)->Arg(4096)->Arg(65536)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_EntropyPerPoint, optimized, false)
+  ->ArgName("point")->Arg(512)->Arg(4096)->Arg(65536)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_SlidingEntropy, reference, true)
+  ->ArgName("point")->Arg(16)->Arg(256)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_SlidingEntropy, optimized, false)
+  ->ArgName("point")->Arg(16)->Arg(256)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_StatsPerPoint)
+  ->ArgName("point")->Arg(512)->Arg(4096)->Arg(65536)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SlidingStats)
+  ->ArgName("point")->Arg(16)->Arg(256)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EntropyPerPointParallel)
+  ->ArgName("point")->Arg(512)->Arg(4096)->Arg(65536)
+  ->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_SlidingEntropyParallel)
+  ->ArgName("point")->Arg(16)->Arg(256)
+  ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}
+}
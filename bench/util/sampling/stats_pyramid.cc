@@ -0,0 +1,61 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "benchmark/benchmark.h"
+#include "util/sampling/stats_pyramid.h"
+
+namespace veles {
+namespace util {
+
+static data::BinData input(size_t size) {
+  data::BinData data(8, size);
+  for (size_t i = 0; i < data.size(); i++)
+    data.setElement64(i, i * 0x5b);
+  return data;
+}
+
+/** Builds the pyramid from scratch, as done when data is loaded.  */
+static void BM_StatsPyramidBuild(benchmark::State &state) {
+  data::BinData data = input(state.range(0));
+  while (state.KeepRunning()) {
+    StatsPyramid pyramid(data);
+    pyramid.build();
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+/** Applies a one byte edit, which should cost the same for any input
+    size.  */
+static void BM_StatsPyramidUpdate(benchmark::State &state) {
+  data::BinData data = input(state.range(0));
+  StatsPyramid pyramid(data);
+  pyramid.build();
+  size_t offset = 0;
+  while (state.KeepRunning()) {
+    pyramid.update(data, offset, offset + 1);
+    offset = (offset + 12345679) % data.size();
+  }
+}
+
+BENCHMARK(BM_StatsPyramidBuild)
+  ->ArgName("size")->Arg(16 << 20)->Arg(256 << 20)
+  ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_StatsPyramidUpdate)
+  ->ArgName("size")->Arg(16 << 20)->Arg(256 << 20)
+  ->Unit(benchmark::kMicrosecond);
+
+}
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "benchmark/benchmark.h"
+#include "util/sampling/uniform_sampler.h"
+
+namespace veles {
+namespace util {
+
+/** Builds a complete sample (window selection and gather) out of twice as
+    much data, the way a visualisation refresh does.  */
+static void BM_UniformSample(benchmark::State &state) {
+  size_t sample_size = state.range(0);
+  data::BinData data(8, 2 * sample_size);
+  for (size_t i = 0; i < data.size(); i++)
+    data.setElement64(i, i * 0x5b);
+  SamplerStats stats = SamplerStats();
+  while (state.KeepRunning()) {
+    UniformSampler sampler(data);
+    sampler.setSampleSize(sample_size);
+    benchmark::DoNotOptimize(sampler.data());
+    stats = sampler.getStats();
+  }
+  state.SetBytesProcessed(state.iterations() * sample_size);
+  // Split of the time between choosing windows and gathering them.
+  state.counters["init_ms"] = stats.initialise_ns / 1e6;
+  state.counters["gather_ms"] = stats.data_ns / 1e6;
+}
+
+BENCHMARK(BM_UniformSample)
+  ->ArgName("sample")->Arg(1 << 20)->Arg(16 << 20)->Arg(256 << 20)
+  ->Unit(benchmark::kMillisecond);
+
+}
+}
@@ -0,0 +1,14 @@
+# Google Benchmark
+
+if(BENCHMARK_SRC_PATH)
+  set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+  add_subdirectory(${BENCHMARK_SRC_PATH} "benchmark-bin")
+  set(BENCHMARK_FOUND true)
+  set(BENCHMARK_LIBRARY "benchmark")
+else(BENCHMARK_SRC_PATH)
+  find_package(benchmark QUIET)
+  if(benchmark_FOUND)
+    set(BENCHMARK_FOUND true)
+    set(BENCHMARK_LIBRARY benchmark::benchmark)
+  endif(benchmark_FOUND)
+endif(BENCHMARK_SRC_PATH)
@@ -18,15 +18,21 @@
 #define VELES_DATA_BINDATA_H
 
 #include <QString>
+#include <QtEndian>
 #include <assert.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
+#include <atomic>
 #include <initializer_list>
+#include <iterator>
+#include <memory>
 
 namespace veles {
 namespace data {
 
+template<typename T> class ElementSpan;
+class ElementReader;
 
 /** Represents all kinds of uniform-sized raw binary data.
 
@@ -35,9 +41,11 @@ namespace data {
     thousand should be OK).  The data is stored as a big array of octets -
     each element is stored as ceil(width/8) octets in little-endian format.
 
-    This class has value semantics, but copying large instances may be
-    rather expensive - use references in this case, or extract a subrange
-    of in interesting data to pass around.  */
+    This class has value semantics, but the raw data is implicitly shared:
+    copying an instance or extracting a subrange with data() only takes
+    a reference to the same backing storage, and is O(1) regardless of
+    the data size.  The storage is copied (detached) on the first
+    modification of an instance that shares it with someone else.  */
 
 class BinData {
  public:
@@ -45,10 +53,10 @@ class BinData {
       raw data.  ceil(width/8) * size octets are read from init_data.
       If raw data is not given, the instance is initialized with zeros.  */
   BinData(unsigned width, size_t size, const uint8_t *init_data = nullptr)
-    : width_(width), size_(size) {
+    : width_(width), size_(size), read_only_(false) {
     assert(width != 0);
     if (!isInline())
-      data_ = new uint8_t[octets()];
+      allocate();
     if (init_data)
       memcpy(rawData(), init_data, octets());
     else
@@ -65,31 +73,33 @@ class BinData {
       setElement64(pos++, x);
   }
 
-  /** Constructs a BinData instance from another one.  */
+  /** Constructs a BinData instance from another one.  The raw data is
+      shared with the other instance until either of them is modified.  */
   BinData(const BinData &other)
-    : BinData(other.width(), other.size(), other.rawData()) {}
+    : width_(other.width_), size_(other.size_), storage_(other.storage_),
+      read_only_(other.read_only_) {
+    memcpy(idata_, other.idata_, sizeof idata_);
+  }
 
-  /** Deletes this instance's data and replaces it with that of another one.  */
+  /** Replaces this instance's data with that of another one.  The raw data
+      is shared with the other instance until either of them is modified.  */
   BinData &operator=(const BinData &other) {
-    if (!isInline())
-      delete[] data_;
     width_ = other.width_;
     size_ = other.size_;
-    if (!isInline())
-      data_ = new uint8_t[octets()];
-    memcpy(rawData(), other.rawData(), octets());
+    storage_ = other.storage_;
+    read_only_ = other.read_only_;
+    memcpy(idata_, other.idata_, sizeof idata_);
     return *this;
   }
 
   /** Constructs a BinData instance from another one, with move semantics.
       The internal data storage is moved from the other instance if necessary,
-      avoiding a new allocation and a copy.  */
+      avoiding touching the reference count.  */
   BinData(BinData &&other)
-    : width_(other.width_), size_(other.size_) {
-    if (isInline()) {
-      memcpy(idata_, other.idata_, sizeof idata_);
-    } else {
-      data_ = other.data_;
+    : width_(other.width_), size_(other.size_),
+      storage_(std::move(other.storage_)), read_only_(other.read_only_) {
+    memcpy(idata_, other.idata_, sizeof idata_);
+    if (!isInline()) {
       other.size_ = 0;
       other.width_ = 0;
     }
@@ -97,16 +107,14 @@ class BinData {
 
   /** Assigns a BinData instance from another one, with move semantics.
       The internal data storage is moved from the other instance if necessary,
-      avoiding a new allocation and a copy.  The old data is destroyed.  */
+      avoiding touching the reference count.  The old data is released.  */
   BinData &operator=(BinData &&other) {
-    if (!isInline())
-      delete[] data_;
     width_ = other.width_;
     size_ = other.size_;
-    if (isInline()) {
-      memcpy(idata_, other.idata_, sizeof idata_);
-    } else {
-      data_ = other.data_;
+    storage_ = std::move(other.storage_);
+    read_only_ = other.read_only_;
+    memcpy(idata_, other.idata_, sizeof idata_);
+    if (!isInline()) {
       other.size_ = 0;
       other.width_ = 0;
     }
@@ -128,11 +136,13 @@ class BinData {
     return res;
   }
 
-  /** Destroys instance's storage, if necessary.  */
-  ~BinData() {
-    if (!isInline())
-      delete[] data_;
-  }
+  /** Constructs an 8-bit BinData instance with the contents of a file.
+      Whenever possible, the file is memory-mapped read-only instead of
+      being read, so that no memory proportional to the file size is used
+      until the data is modified - the mapping is then detached into
+      private memory like any other shared storage.  If the file cannot be
+      opened, returns an empty instance and sets *ok (if given) to false.  */
+  static BinData fromFile(const QString &path, bool *ok = nullptr);
 
   /** Returns element width, in bits.  */
   unsigned width() const { return width_; }
@@ -149,8 +159,25 @@ class BinData {
 
   /** Returns a pointer to the raw data, starting from a given element
       (or from element 0 if not given).  Elements are contiguous in memory,
-      with each element octetsPerElement() octets after the previous one.  */
+      with each element octetsPerElement() octets after the previous one.
+      If the storage is shared with another instance, it is detached first.
+      The returned pointer is only valid until this instance is copied,
+      assigned or destroyed.
+
+      Two things make this overload more expensive than it looks, so use
+      the const one whenever the data is only read:
+
+      - On read-only storage (a memory-mapped file, see fromFile()),
+        the whole range of this instance is copied into private memory,
+        even if no other instance shares it.  Calling this on a view of
+        a big mapped file copies all of it.
+      - Whether the storage is shared is decided by a use count, which is
+        only a snapshot.  That is enough as long as nobody copies this very
+        instance while it is being modified - no other instance can start
+        sharing the storage otherwise.  Do not hand an instance to another
+        thread (eg. a sampler worker) and keep modifying it here.  */
   uint8_t *rawData(size_t el = 0) {
+    detach();
     uint8_t *d = isInline() ? idata_ : data_;
     return d + el * octetsPerElement();
   }
@@ -165,11 +192,14 @@ class BinData {
 
   /** Returns a subrange of data.  Both start and end are counted in elements
       from start of the array.  start is included in the returned range, end
-      is not included.  The result has the same width as this instance.  */
+      is not included.  The result has the same width as this instance,
+      and shares the raw data with it.  */
   BinData data(size_t start, size_t end) const {
     assert(start <= end);
     assert(end <= size_);
-    return BinData(width_, end - start, rawData(start));
+    if (isInline(width_, end - start))
+      return BinData(width_, end - start, rawData(start));
+    return BinData(width_, end - start, storage_, rawData(start), read_only_);
   }
 
   /** Returns a single element of data, as a single-element BinData
@@ -179,7 +209,7 @@ class BinData {
   /** Returns a subrange of bits of a single element of data.  Bits are
       counted from LSB, 0-based.  Result is a single-element BinData
       with a width equal to num_bits.  */
-  BinData bits(size_t el, unsigned start_bit, unsigned num_bits) {
+  BinData bits(size_t el, unsigned start_bit, unsigned num_bits) const {
     assert(start_bit + num_bits <= width_);
     assert(el < size_);
     BinData res(num_bits, 1);
@@ -206,6 +236,20 @@ class BinData {
     return bits64(el, 0, width_);
   }
 
+  /** Returns a view of all elements as native integers of type T, which
+      must be uint8_t, uint16_t, uint32_t or uint64_t matching the width
+      exactly.  Elements are read directly from the raw data, so loops
+      over the view run at memory speed.  Like the pointer returned by
+      rawData(), the view is only valid until this instance is modified
+      or destroyed.  */
+  template<typename T>
+  ElementSpan<T> elements() const;
+
+  /** Returns a view of all elements as uint64_t, for any width up to 64.
+      Slower than elements(), but still much faster than element64()
+      when reading many elements.  Same validity rules as elements().  */
+  ElementReader elementReader() const;
+
   /** Replaces a range of elements with the contents of another
       BinData instance.  The widths of both BinDatas must match,
       and size of the replaced range must be equal to the size
@@ -273,20 +317,191 @@ class BinData {
  private:
   unsigned width_;
   size_t size_;
+  /** Backing storage of raw data iff isInline() is false.  May be shared
+      by any number of instances, each looking at its own range of it.  */
+  std::shared_ptr<uint8_t> storage_;
+  /** True iff storage_ must never be written to, even when it is not
+      shared with any other instance (eg. because it maps a file).  */
+  bool read_only_;
   union {
-    /** Pointer to raw data iff isInline() is false.  */
+    /** Pointer to raw data (within storage_) iff isInline() is false.  */
     uint8_t *data_;
     /** The array containing raw data iff isInline() is true.  */
     uint8_t idata_[8];
   };
+
+  /** Constructs a non-inline BinData instance looking at a range of existing
+      storage.  */
+  BinData(unsigned width, size_t size,
+          const std::shared_ptr<uint8_t> &storage, const uint8_t *data,
+          bool read_only)
+    : width_(width), size_(size), storage_(storage), read_only_(read_only) {
+    data_ = const_cast<uint8_t *>(data);
+  }
+
+  /** Allocates fresh, unshared storage for octets() octets of raw data.  */
+  void allocate() {
+    storage_.reset(new uint8_t[octets()], std::default_delete<uint8_t[]>());
+    read_only_ = false;
+    data_ = storage_.get();
+  }
+
+  /** Makes sure the storage is not shared with any other instance, so that
+      it can be modified.  */
+  void detach() {
+    if (isInline())
+      return;
+    if (!read_only_ && storage_.use_count() <= 1) {
+      // use_count() is a relaxed load - pair it with the release done by
+      // the last other owner when it let go, so that its reads of the
+      // storage happen before our writes.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return;
+    }
+    const uint8_t *old_data = data_;
+    std::shared_ptr<uint8_t> old_storage = std::move(storage_);
+    allocate();
+    memcpy(data_, old_data, octets());
+  }
+
   /** Returns true iff this instance has inline data, ie. stores the raw data
-      directly in the instance (as opposed to new[]-allocated memory).  This
+      directly in the instance (as opposed to shared storage).  This
       is currently done for single-element arrays of up to 64-bit width.  */
   bool isInline() const {
-    return size_ <= 1 && width_ <= (sizeof idata_ * 8);
+    return isInline(width_, size_);
+  }
+  static bool isInline(unsigned width, size_t size) {
+    return size <= 1 && width <= 64;
+  }
+};
+
+/** Random access iterator over the elements of an ElementSpan or
+    an ElementReader.  Dereferencing yields elements by value.  */
+template<typename View>
+class ElementIterator {
+ public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef typename View::value_type value_type;
+  typedef ptrdiff_t difference_type;
+  typedef const value_type *pointer;
+  typedef value_type reference;
+
+  ElementIterator() : view_(nullptr), pos_(0) {}
+  ElementIterator(const View *view, size_t pos) : view_(view), pos_(pos) {}
+
+  value_type operator*() const { return (*view_)[pos_]; }
+  value_type operator[](difference_type n) const { return (*view_)[pos_ + n]; }
+
+  ElementIterator &operator++() { ++pos_; return *this; }
+  ElementIterator &operator--() { --pos_; return *this; }
+  ElementIterator operator++(int) { return ElementIterator(view_, pos_++); }
+  ElementIterator operator--(int) { return ElementIterator(view_, pos_--); }
+  ElementIterator &operator+=(difference_type n) { pos_ += n; return *this; }
+  ElementIterator &operator-=(difference_type n) { pos_ -= n; return *this; }
+  ElementIterator operator+(difference_type n) const {
+    return ElementIterator(view_, pos_ + n);
   }
+  ElementIterator operator-(difference_type n) const {
+    return ElementIterator(view_, pos_ - n);
+  }
+  difference_type operator-(const ElementIterator &other) const {
+    return difference_type(pos_) - difference_type(other.pos_);
+  }
+
+  bool operator==(const ElementIterator &other) const { return pos_ == other.pos_; }
+  bool operator!=(const ElementIterator &other) const { return pos_ != other.pos_; }
+  bool operator<(const ElementIterator &other) const { return pos_ < other.pos_; }
+  bool operator>(const ElementIterator &other) const { return pos_ > other.pos_; }
+  bool operator<=(const ElementIterator &other) const { return pos_ <= other.pos_; }
+  bool operator>=(const ElementIterator &other) const { return pos_ >= other.pos_; }
+
+ private:
+  const View *view_;
+  size_t pos_;
 };
 
+/** A read-only view of BinData elements as native integers of type T,
+    for data whose width is exactly 8 * sizeof(T).  Such elements are
+    stored as contiguous little-endian T values, so for uint8_t the raw
+    data can be used directly, and reading an element is a single
+    load.  Use BinData::elements() to get one.  */
+template<typename T>
+class ElementSpan {
+ public:
+  typedef T value_type;
+  typedef ElementIterator<ElementSpan> const_iterator;
+
+  ElementSpan(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  /** Returns the raw data, sizeof(T) octets per element.  */
+  const uint8_t *rawData() const { return data_; }
+
+  T operator[](size_t pos) const {
+    return qFromLittleEndian<T>(data_ + pos * sizeof(T));
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+};
+
+/** A read-only view of BinData elements of any width up to 64 bits,
+    yielding them as uint64_t.  Each element is decoded with a single
+    unaligned 64-bit load and a mask wherever there are 8 octets left to
+    read, instead of a copyBits call per element.  Use
+    BinData::elementReader() to get one.  */
+class ElementReader {
+ public:
+  typedef uint64_t value_type;
+  typedef ElementIterator<ElementReader> const_iterator;
+
+  ElementReader(const uint8_t *data, size_t size, unsigned width)
+    : data_(data), size_(size), stride_((width + 7) / 8),
+      mask_(width >= 64 ? ~uint64_t(0) : (uint64_t(1) << width) - 1) {
+    assert(width <= 64);
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  uint64_t operator[](size_t pos) const {
+    const uint8_t *src = data_ + pos * stride_;
+    uint64_t res = 0;
+    if ((size_ - pos) * stride_ >= 8) {
+      res = qFromLittleEndian<quint64>(src);
+    } else {
+      for (unsigned i = 0; i < stride_; i++)
+        res |= uint64_t(src[i]) << (8 * i);
+    }
+    return res & mask_;
+  }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, size_); }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+  unsigned stride_;
+  uint64_t mask_;
+};
+
+template<typename T>
+ElementSpan<T> BinData::elements() const {
+  assert(width_ == 8 * sizeof(T));
+  return ElementSpan<T>(rawData(), size_);
+}
+
+inline ElementReader BinData::elementReader() const {
+  return ElementReader(rawData(), size_, width_);
+}
+
 }
 }
 
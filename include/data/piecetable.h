@@ -0,0 +1,136 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef VELES_DATA_PIECETABLE_H
+#define VELES_DATA_PIECETABLE_H
+
+#include <memory>
+#include <vector>
+
+#include "data/bindata.h"
+
+namespace veles {
+namespace data {
+
+/** Represents a large, editable array of uniform-sized binary data.
+
+    The data is kept as a sequence of BinData pieces, each of them usually
+    a subrange of some bigger (shared) BinData: initially there is a single
+    piece holding the whole array, and every replace() splits the pieces
+    around the edited range and puts the new data between them.  The
+    untouched data is never copied.  Small adjacent pieces are merged, to
+    keep the piece count low when the data is edited an element at
+    a time.
+
+    The pieces are the leaves of a balanced binary tree (a treap keyed by
+    position), whose nodes are never modified once built: an edit builds
+    new nodes along the paths to the edited range and shares the rest of
+    the tree with the old version.  This makes PieceTable a cheap
+    snapshot type:
+
+    - copying a PieceTable is O(1), and the copy is not affected by later
+      edits of the original (or the other way around),
+    - replace() and slice() take O(log(pieces)) time, plus the size of
+      the new data (and of the small pieces it is merged with),
+    - reading a range that lies within a single piece returns a BinData
+      sharing its storage; only ranges spanning several pieces are
+      copied, and pieces() gives them all without copying anything.
+
+    Snapshots can be handed to other threads, as long as each instance
+    is only used by one thread at a time.  */
+
+class PieceTable {
+ public:
+  /** Constructs a PieceTable with the contents of the given BinData,
+      as a single piece sharing its storage.  */
+  PieceTable(const BinData &data = BinData());
+
+  /** Returns the width of the elements, in bits.  */
+  unsigned width() const { return width_; }
+
+  /** Returns the number of elements.  */
+  uint64_t size() const;
+
+  /** Returns the number of pieces the data is currently split into.  */
+  size_t pieceCount() const;
+
+  /** Returns a range of elements.  start is included in the returned range,
+      end is not included.  If the range lies within a single piece,
+      the result shares the raw data with it.  */
+  BinData data(uint64_t start, uint64_t end) const;
+
+  /** Returns all elements.  This is a copy of the whole data, unless it is
+      all in a single piece.  */
+  BinData data() const { return data(0, size()); }
+
+  /** Returns the pieces covering a range of elements, in order, trimmed
+      to the range.  Nothing is copied - all of them share the raw data
+      with this instance.  */
+  std::vector<BinData> pieces(uint64_t start, uint64_t end) const;
+
+  /** Returns a range of elements as a PieceTable sharing all the pieces
+      with this one.  Addressing is the same as in data().  */
+  PieceTable slice(uint64_t start, uint64_t end) const;
+
+  /** Returns a single element as an uint64_t.  Width must be at most 64.
+      Takes O(log(pieces)) time - use data() or pieces() to read more
+      than a few elements.  */
+  uint64_t element64(uint64_t pos) const;
+
+  /** Replaces a range of elements with the contents of a BinData instance
+      of the same width.  The sizes of the range and of the new data can be
+      different, so this can also insert and delete elements.  */
+  void replace(uint64_t start, uint64_t end, const BinData &data);
+
+  /** Returns an opaque pointer identifying this version of the data:
+      unmodified copies of an instance return the same pointer, and no
+      instance with different contents does while this one is alive.
+      Instances with equal contents may still return different pointers,
+      so this is only good as a cheap cache key.  */
+  const void *version() const { return root_.get(); }
+
+ private:
+  struct Node;
+  typedef std::shared_ptr<const Node> NodePtr;
+
+  NodePtr root_;
+  unsigned width_;
+
+  /** Pieces not bigger than this (in octets) are merged with small
+      neighbours after an edit.  */
+  static const size_t MERGE_OCTETS = 0x1000;
+
+  PieceTable(const NodePtr &root, unsigned width)
+    : root_(root), width_(width) {}
+
+  static NodePtr makeNode(const BinData &data, const NodePtr &left,
+                          const NodePtr &right, uint64_t priority);
+  static NodePtr makeLeaf(const BinData &data);
+  /** Concatenates two trees.  */
+  static NodePtr merge(const NodePtr &left, const NodePtr &right);
+  /** Splits a tree into the first pos elements and the rest, splitting
+      the piece containing pos if needed.  */
+  static std::pair<NodePtr, NodePtr> split(const NodePtr &node, uint64_t pos);
+  static const BinData &firstPiece(const NodePtr &node);
+  static const BinData &lastPiece(const NodePtr &node);
+  static void collectPieces(const NodePtr &node, uint64_t start, uint64_t end,
+                            std::vector<BinData> *out);
+};
+
+}
+}
+
+#endif
@@ -17,7 +17,10 @@
 #ifndef VELES_DATA_REPACK_H
 #define VELES_DATA_REPACK_H
 
+#include <QtEndian>
+
 #include "data/bindata.h"
+#include "data/piecetable.h"
 
 namespace veles {
 namespace data {
@@ -84,6 +87,96 @@ size_t repackableSize(unsigned src_width,
                       const RepackFormat &format,
                       size_t src_size);
 
+/** Reads the result of a repacking in batches, without ever materializing
+    all of it.  The concatenation of all batches returned by next() is equal
+    to the result of repack() with the same arguments, but only one batch
+    exists at a time, so memory use stays proportional to the batch size.
+
+    Batch sizes are rounded up to a multiple of the number of elements per
+    repacking unit (see repackUnit()), so that every batch starts on a unit
+    boundary in the source and endian and padding semantics are exactly
+    those of repack().  The source is a PieceTable snapshot (a BinData
+    converts to it implicitly), and each batch only takes the source
+    elements it needs from it - shared with the piece they lie in, or
+    copied if they span several pieces.  */
+class RepackCursor {
+ public:
+  /** The default number of elements per batch.  */
+  static const size_t DEFAULT_BATCH_SIZE = 0x1000;
+
+  /** Constructs a cursor over repack(src, format, start, num_elements).  */
+  RepackCursor(const PieceTable &src, const RepackFormat &format,
+               size_t start = 0, size_t num_elements = SIZE_MAX,
+               size_t batch_size = DEFAULT_BATCH_SIZE);
+
+  /** Returns the total number of elements the cursor will yield, ie.
+      num_elements limited to what is actually available in the source.  */
+  size_t size() const { return size_; }
+
+  /** Returns the index of the first element of the next batch.  */
+  size_t pos() const { return pos_; }
+
+  /** Returns true iff all elements have been read.  */
+  bool atEnd() const { return pos_ == size_; }
+
+  /** Returns the next batch of elements.  All batches have the same
+      (rounded) batch size, except for the last one, which may be
+      smaller.  Returns an empty BinData at the end.  */
+  BinData next();
+
+ private:
+  PieceTable src_;
+  RepackFormat format_;
+  size_t src_pos_;
+  size_t pos_;
+  size_t size_;
+  size_t batch_size_;
+  unsigned src_per_unit_, dst_per_unit_;
+};
+
+/** Maps an element width, in bits, to the native unsigned integer type
+    holding it.  */
+template<unsigned Width> struct RepackUint;
+template<> struct RepackUint<8> { typedef uint8_t type; };
+template<> struct RepackUint<16> { typedef uint16_t type; };
+template<> struct RepackUint<32> { typedef uint32_t type; };
+template<> struct RepackUint<64> { typedef uint64_t type; };
+
+/** Describes an unpadded 8, 16, 32 or 64-bit repacking format at compile
+    time.  For 8-bit source data, elements of such a format are just
+    little- or big-endian integers, and decode() reads one straight from
+    the source octets into a native integer - the result is the same as
+    that of repack() with format(), but without the generic repacking
+    logic and without constructing a BinData.  */
+template<RepackEndian Endian, unsigned Width>
+struct StaticRepackFormat {
+  /** Native type of a decoded element.  */
+  typedef typename RepackUint<Width>::type type;
+
+  /** Number of source octets read per element.  */
+  static constexpr unsigned octets() { return Width / 8; }
+
+  /** The equivalent runtime format.  */
+  static constexpr RepackFormat format() {
+    return RepackFormat{Endian, Width, 0, 0};
+  }
+
+  /** Decodes a single element from octets() octets at src.  */
+  static type decode(const uint8_t *src) {
+    if (Endian == RepackEndian::LITTLE)
+      return qFromLittleEndian<type>(src);
+    return qFromBigEndian<type>(src);
+  }
+};
+
+typedef StaticRepackFormat<RepackEndian::LITTLE, 8> RepackByte;
+typedef StaticRepackFormat<RepackEndian::LITTLE, 16> RepackLe16;
+typedef StaticRepackFormat<RepackEndian::BIG, 16> RepackBe16;
+typedef StaticRepackFormat<RepackEndian::LITTLE, 32> RepackLe32;
+typedef StaticRepackFormat<RepackEndian::BIG, 32> RepackBe32;
+typedef StaticRepackFormat<RepackEndian::LITTLE, 64> RepackLe64;
+typedef StaticRepackFormat<RepackEndian::BIG, 64> RepackBe64;
+
 }
 }
 
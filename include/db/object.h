@@ -25,6 +25,7 @@
 #include "dbif/types.h"
 #include "db/types.h"
 #include "data/bindata.h"
+#include "data/piecetable.h"
 
 namespace veles {
 namespace db {
@@ -77,10 +78,12 @@ class RootLocalObject : public LocalObject {
 
 class DataBlobObject : public LocalObject {
   LocalObject *parent_;
-  data::BinData data_;
+  data::PieceTable data_;
   QMap<InfoGetter *, std::pair<uint64_t, uint64_t>> data_watchers_;
 
   void data_reply(InfoGetter *getter, uint64_t start, uint64_t end);
+  void data_changed_reply(InfoGetter *getter, uint64_t start, uint64_t end,
+                          uint64_t changed_start, uint64_t changed_end);
   void remove_data_watcher(InfoGetter *getter);
 
  protected:
@@ -93,7 +96,7 @@ class DataBlobObject : public LocalObject {
   LocalObject *parent() { return parent_; }
   void getInfo(InfoGetter *getter, PInfoRequest req, bool once) override;
   void runMethod(MethodRunner *runner, PMethodRequest req) override;
-  const data::BinData &data() const { return data_; }
+  const data::PieceTable &data() const { return data_; }
 };
 
 class FileBlobObject : public DataBlobObject {
@@ -38,6 +38,7 @@ struct ObjectInvalidRequestError : Error {};
 struct BlobDataInvalidRangeError : Error {};
 struct BlobDataInvalidWidthError : Error {};
 struct InvalidTypeError : Error {};
+struct FileOpenError : Error {};
 
 };
 };
@@ -24,6 +24,7 @@
 #include "dbif/types.h"
 #include "data/field.h"
 #include "data/bindata.h"
+#include "data/piecetable.h"
 
 namespace veles {
 namespace dbif {
@@ -125,11 +126,19 @@ struct ChildrenReply : InfoReply {
 };
 
 struct BlobDataReply : InfoReply {
-  data::BinData data;
-  BlobDataReply(const data::BinData &data) :
-    data(data) {}
-  BlobDataReply(data::BinData &&data) :
-    data(data) {}
+  // A snapshot of the requested range - it shares the pieces with the
+  // blob, so sending it costs nothing proportional to the range size.
+  data::PieceTable data;
+  // Part of data (relative to its start) that may differ from the previous
+  // reply to the same request - all of it, unless the reply was caused by
+  // an edit which didn't move anything.
+  uint64_t changed_start;
+  uint64_t changed_end;
+  BlobDataReply(const data::PieceTable &data) :
+    data(data), changed_start(0), changed_end(data.size()) {}
+  BlobDataReply(const data::PieceTable &data, uint64_t changed_start,
+                uint64_t changed_end) :
+    data(data), changed_start(changed_start), changed_end(changed_end) {}
 };
 
 struct ChunkDataReply : InfoReply {
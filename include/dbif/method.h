@@ -50,6 +50,13 @@ struct RootCreateFileBlobFromDataRequest : MethodRequest {
   typedef CreatedReply ReplyType;
 };
 
+struct RootCreateFileBlobFromFileRequest : MethodRequest {
+  QString path;
+  explicit RootCreateFileBlobFromFileRequest(const QString &path) :
+    path(path) {}
+  typedef CreatedReply ReplyType;
+};
+
 struct ChunkCreateRequest : MethodRequest {
   QString name;
   QString chunk_type;
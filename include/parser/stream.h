@@ -22,9 +22,18 @@
 #include "dbif/info.h"
 #include "data/repack.h"
 
+#include <algorithm>
+
 namespace veles {
 namespace parser {
 
+/** Reads consecutive fields of a blob, creating chunks and their items
+    in the database as it goes.
+
+    Data is fetched ahead in windows of WINDOW_SIZE elements, which are
+    not refreshed when the blob changes.  The blob must therefore not
+    be modified while a StreamParser on it is live - an edit made during
+    parsing may be seen by some fields and not by others.  */
 class StreamParser {
   dbif::ObjectHandle blob_;
   uint64_t pos_;
@@ -41,6 +50,32 @@ class StreamParser {
   unsigned width_;
   size_t blob_size_;
 
+  /** A span of the blob fetched ahead of pos_, so that a run of small
+      fields doesn't cost a database roundtrip each.  */
+  data::BinData window_;
+  uint64_t window_start_ = 0;
+  static const uint64_t WINDOW_SIZE = 0x10000;
+
+  /** Makes sure the window covers len elements starting at pos_ (or as
+      many of them as the blob has), and returns the number of elements
+      available.  pos_ must be inside the blob.  */
+  uint64_t fill(uint64_t len) {
+    uint64_t window_end = window_start_ + window_.size();
+    if (pos_ < window_start_ || pos_ > window_end ||
+        (pos_ + len > window_end && window_end < blob_size_)) {
+      window_ = blob_->syncGetInfo<dbif::BlobDataRequest>(
+        pos_, pos_ + std::max(len, uint64_t(WINDOW_SIZE)))->data.data();
+      window_start_ = pos_;
+      window_end = window_start_ + window_.size();
+    }
+    return std::min(len, window_end - pos_);
+  }
+
+  /** Returns a pointer to the raw data of the window at pos_.  */
+  const uint8_t *windowData() const {
+    return window_.rawData(pos_ - window_start_);
+  }
+
  public:
   StreamParser(dbif::ObjectHandle blob, uint64_t start) :
     blob_(blob), pos_(start) {
@@ -80,9 +115,10 @@ class StreamParser {
     size_t src_sz = data::repackSize(width_, repack, num_elements);
     if (pos_ >= blob_size_)
       return data::BinData();
-    auto data = blob_->syncGetInfo<veles::dbif::BlobDataRequest>(pos_, pos_+src_sz);
+    fill(src_sz);
+    data::BinData res = data::repack(
+      window_, repack, pos_ - window_start_, num_elements);
     pos_ += src_sz;
-    data::BinData res = data::repack(data->data, repack, 0, num_elements);
     stack_.back().items.push_back(data::ChunkDataItem::field(
       pos_ - src_sz, pos_, name,
       repack, num_elements, high_type, res
@@ -90,57 +126,72 @@ class StreamParser {
     return res;
   }
 
+  /** Reads a single field of a format known at compile time (one of
+      data::StaticRepackFormat).  Same as getData with Format::format(),
+      but on 8-bit blobs the value is decoded straight from the fetched
+      octets, without going through the generic repacking.  */
+  template<typename Format>
+  typename Format::type getField(
+      const QString &name,
+      const data::FieldHighType &high_type = data::FieldHighType()) {
+    if (width_ != 8) {
+      auto data = getData(name, Format::format(), 1, high_type);
+      if (!data.size())
+        return 0;
+      return data.element64();
+    }
+    if (pos_ >= blob_size_)
+      return 0;
+    uint64_t start = pos_;
+    bool complete = fill(Format::octets()) == Format::octets();
+    typename Format::type res = 0;
+    data::BinData raw_value(Format::format().width, 0);
+    if (complete) {
+      res = Format::decode(windowData());
+      raw_value = data::BinData(Format::format().width, {res});
+    }
+    pos_ += Format::octets();
+    stack_.back().items.push_back(data::ChunkDataItem::field(
+      start, pos_, name, Format::format(), 1, high_type, raw_value
+    ));
+    return res;
+  }
+
   uint32_t getLe32(
       const QString &name,
       data::FieldHighType::FieldSignMode sign_mode = data::FieldHighType::UNSIGNED) {
-    auto data = getData(
-      name, data::RepackFormat{data::RepackEndian::LITTLE, 32}, 1,
-      data::FieldHighType::fixed(sign_mode));
-    if (!data.size())
-      return 0;
-    return data.element64();
+    return getField<data::RepackLe32>(
+      name, data::FieldHighType::fixed(sign_mode));
   }
 
   uint32_t getBe32(
       const QString &name,
       data::FieldHighType::FieldSignMode sign_mode = data::FieldHighType::UNSIGNED) {
-    auto data = getData(
-      name, data::RepackFormat{data::RepackEndian::BIG, 32}, 1,
-      data::FieldHighType::fixed(sign_mode));
-    if (!data.size())
-      return 0;
-    return data.element64();
+    return getField<data::RepackBe32>(
+      name, data::FieldHighType::fixed(sign_mode));
   }
 
   std::vector<uint8_t> getBytes(const QString &name, uint64_t len) {
     auto data = getData(
       name, data::RepackFormat{data::RepackEndian::LITTLE, 8}, len,
       data::FieldHighType());
-    std::vector<uint8_t> res;
-    for (size_t i = 0; i < data.size(); i++) {
-      res.push_back(data.element64(i));
-    }
-    return res;
+    auto bytes = data.elements<uint8_t>();
+    return std::vector<uint8_t>(bytes.rawData(), bytes.rawData() + bytes.size());
   }
 
   uint8_t getByte(const QString &name) {
-    auto data = getData(
-      name, data::RepackFormat{data::RepackEndian::LITTLE, 8}, 1,
-      data::FieldHighType());
-    if (!data.size())
-      return 0;
-    return data.element64();
+    return getField<data::RepackByte>(name);
   }
 
   std::vector<uint16_t> getLe16(const QString &name, uint64_t num) {
-    std::vector<uint16_t> res;
     auto data = getData(
       name, data::RepackFormat{data::RepackEndian::LITTLE, 16}, num,
       data::FieldHighType());
-    for (size_t i = 0; i < data.size(); i++) {
-      res.push_back(data.element64(i));
-    }
-    return res;
+    // Past the end, getData() returns an empty BinData of width 8.
+    if (!data.size())
+      return std::vector<uint16_t>();
+    auto elements = data.elements<uint16_t>();
+    return std::vector<uint16_t>(elements.begin(), elements.end());
   }
 
   bool eof() {
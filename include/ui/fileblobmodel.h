@@ -27,6 +27,7 @@
 #include "dbif/types.h"
 #include "ui/fileblobitem.h"
 #include "data/bindata.h"
+#include "data/piecetable.h"
 
 namespace veles {
 namespace ui {
@@ -57,7 +58,9 @@ class FileBlobModel : public QAbstractItemModel {
   QModelIndex indexFromPos(uint64_t pos,
                            const QModelIndex &parent = QModelIndex());
 
-  const data::BinData& binData() {return binData_;}
+  // A snapshot of the blob - it shares the pieces with the database, so
+  // read ranges of it with data() rather than flattening all of it.
+  const data::PieceTable& binData() {return binData_;}
   bool isRemovable(const QModelIndex &index = QModelIndex());
   void uploadNewData(const QByteArray &buf);
 
@@ -74,6 +77,9 @@ class FileBlobModel : public QAbstractItemModel {
 
  signals:
   void newBinData();
+  // Emitted after newBinData() with the range of binData() that may differ
+  // from the previous one.
+  void binDataChanged(uint64_t start, uint64_t end);
 
  private:
   FileBlobItem *item_;
@@ -82,7 +88,7 @@ class FileBlobModel : public QAbstractItemModel {
   size_t bytesCount_;
   QStringList path_;
 
-  data::BinData binData_;
+  data::PieceTable binData_;
 
   QColor color(int colorIndex) const;
   FileBlobItem *itemFromIndex(const QModelIndex &index) const;
@@ -93,6 +93,8 @@ class HexEdit : public QAbstractScrollArea {
 
   /** Number of first row displayed on the screen */
   qint64 startRow_;
+  /** Number of rows per scroll bar step (above 1 only if rows overflow int) */
+  qint64 rowsPerScrollStep_;
   /** Number of first pixel from left which should be displayed on the screen */
   qint64 startPosX_;
 
@@ -21,6 +21,7 @@
 #include <QtCore>
 #include "include/ui/hexedit.h"
 #include "data/bindata.h"
+#include "data/piecetable.h"
 
 namespace Ui {
 class SearchDialog;
@@ -51,6 +52,10 @@ class SearchDialog : public QDialog {
   qint64 indexOf(const data::BinData& pattern, qint64 startPos);
   void replace(qint64 pos, qint64 len, const data::BinData &data);
 
+  // The blob is searched in windows of this many elements, which are
+  // taken from it without copying unless they span several pieces.
+  static const uint64_t searchWindow_ = 0x100000;
+
   HexEdit *_hexEdit;
   data::BinData _findBa;
   qint64 _lastFoundPos;
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef VELES_UTIL_PARALLEL_H
+#define VELES_UTIL_PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+namespace veles {
+namespace util {
+
+/**
+ * Split [0, count) into contiguous chunks of at least min_chunk items and
+ * call body(begin, end) for each of them, in QThreadPool::globalInstance()
+ * threads and the calling thread. Returns once all chunks are done.
+ *
+ * Chunks must be independent of each other. Small inputs (or a single
+ * core) are handled directly in the calling thread. Must not be called
+ * from the global pool's threads, as it waits for them.
+ */
+void parallelFor(size_t count, size_t min_chunk,
+                 const std::function<void(size_t, size_t)> &body);
+
+}  // namespace util
+}  // namespace veles
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef ASYNC_SAMPLER_H
+#define ASYNC_SAMPLER_H
+
+#include <atomic>
+#include <memory>
+
+#include <QMutex>
+#include <QObject>
+#include <QThreadPool>
+
+#include "util/sampling/isampler.h"
+
+namespace veles {
+namespace util {
+
+/**
+ * Prepares samples in background threads, so that (re-)sampling big inputs
+ * doesn't block the GUI.
+ *
+ * The user configures a fresh Sampler (usually a clone() of the one
+ * currently displayed, with a new range or sample size) and passes it to
+ * request(). The sample is computed on a worker thread, and once it's
+ * complete sampleReady() is emitted in the thread AsyncSampler lives in,
+ * passing the ready Sampler (whose data() and friends are then cheap).
+ * Until then the old Sampler can still be used and displayed.
+ *
+ * If the Sampler supports progressive sampling (see
+ * ISampler::getPassesCount()), sampleReady() is emitted for every pass,
+ * each time with a more detailed Sampler, so the first (coarse) result
+ * arrives quickly even for huge inputs.
+ *
+ * Only the most recent request matters: a new request() (or cancel())
+ * cancels the one in progress, and its result is never delivered.
+ *
+ * Example usage:
+ * connect(async_sampler, &AsyncSampler::sampleReady,
+ *         [this](ISampler *sampler) { replaceSampler(sampler); });
+ * ISampler *next = current_sampler->clone();
+ * next->setRange(start, end);
+ * async_sampler->request(next);
+ */
+class AsyncSampler : public QObject {
+  Q_OBJECT
+
+ public:
+  explicit AsyncSampler(QObject *parent = nullptr);
+  ~AsyncSampler();
+
+  /**
+   * Start sampling in the background. Takes ownership of sampler until
+   * it's passed on by sampleReady(). Cancels any previous request.
+   */
+  void request(ISampler *sampler);
+
+  /**
+   * Cancel the request in progress, if any. Its result is dropped.
+   */
+  void cancel();
+
+  /**
+   * Return true if a request is in progress.
+   */
+  bool busy();
+
+ signals:
+  /**
+   * Emitted when the sample of the last request (or its next pass) is
+   * ready. The receiver takes ownership of sampler.
+   */
+  void sampleReady(util::ISampler *sampler);
+
+ private slots:
+  void deliverSample();
+
+ private:
+  class Task;
+
+  QThreadPool pool_;
+  QMutex mutex_;
+  uint64_t current_id_;
+  std::shared_ptr<std::atomic<bool>> current_cancelled_;
+  ISampler *ready_;
+  bool ready_complete_;
+};
+
+}  // namespace util
+}  // namespace veles
+
+#endif
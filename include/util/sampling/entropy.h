@@ -0,0 +1,208 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef ENTROPY_H
+#define ENTROPY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace veles {
+namespace util {
+
+/**
+ * Values of n * log2(n) for small n, computed once. Entropy of a histogram
+ * with total count N is log2(N) - sum(f(count)) / N, so it only needs
+ * lookups in this table instead of a log2 per bin.
+ */
+class NLogNTable {
+ public:
+  /** Largest table built, bigger counts are computed on the fly.  */
+  static const size_t MAX_SIZE = 1 << 16;
+
+  /** Create a table covering counts up to size - 1.  */
+  explicit NLogNTable(size_t size);
+
+  double operator()(uint64_t n) const {
+    return n < table_.size() ? table_[n] : compute(n);
+  }
+
+  /** Compute n * log2(n) without the table.  */
+  static double compute(uint64_t n);
+
+ private:
+  std::vector<double> table_;
+};
+
+/**
+ * Add the number of occurrences of every byte value in data to counts
+ * (256 entries). Consecutive bytes go to separate histograms, merged at
+ * the end, so that runs of equal bytes don't stall on incrementing the same
+ * counter over and over.
+ */
+void countBytes(const uint8_t *data, size_t size, uint64_t *counts);
+
+/**
+ * Return the Shannon entropy (in bits, 0 to 8) of a histogram of 256 byte
+ * values with the given total count.
+ */
+double entropy(const uint64_t *counts, uint64_t total,
+               const NLogNTable &table);
+
+/**
+ * Statistics of a run of bytes. They're all derived from its histogram, so
+ * the *StatsPerPoint() kernels compute them together in a single pass.
+ */
+struct ByteStats {
+  /** Average byte value, rounded down.  */
+  float average;
+  /** Shannon entropy, in bits (0 to 8).  */
+  float entropy;
+  /** Fraction of printable ASCII characters, whitespace included.  */
+  float printable;
+  /** Fraction of zero bytes.  */
+  float zeros;
+  /**
+   * Pearson's chi-square statistic of the histogram against uniformly
+   * distributed bytes, divided by its maximum (255 * count) - close to 0
+   * for random data, 1 for a single repeated value.
+   */
+  float chi_square;
+};
+
+/**
+ * Return ByteStats of a histogram of 256 byte values with the given total
+ * count, all 0 for an empty one.
+ */
+ByteStats byteStats(const uint64_t *counts, uint64_t total,
+                    const NLogNTable &table);
+
+/**
+ * Entropy of a window sliding over a byte stream, updated in O(1) when a
+ * byte enters or leaves it.
+ */
+class SlidingEntropy {
+ public:
+  /** max_window is the biggest window size expected (not enforced).  */
+  explicit SlidingEntropy(size_t max_window);
+
+  void push(uint8_t value);
+  void pop(uint8_t value);
+
+  size_t size() const;
+  /** Return the number of occurrences of value in the window.  */
+  uint64_t count(uint8_t value) const;
+  /** Return the entropy of the window in bits, 0 for an empty one.  */
+  double entropy() const;
+
+ private:
+  // Return (n + 1) * log2(n + 1) - n * log2(n), in fixed point.
+  int64_t delta(uint64_t n) const;
+
+  std::vector<int64_t> deltas_;
+  uint64_t counts_[256];
+  size_t size_;
+  // Sum of n * log2(n) over counts_, in fixed point - pop() subtracts
+  // exactly what push() added, so it never drifts.
+  int64_t sum_;
+};
+
+/**
+ * ByteStats of a sliding window, updated in O(1) when a byte enters or
+ * leaves it, like SlidingEntropy.
+ */
+class SlidingStats {
+ public:
+  /** max_window is the biggest window size expected (not enforced).  */
+  explicit SlidingStats(size_t max_window);
+
+  void push(uint8_t value);
+  void pop(uint8_t value);
+
+  size_t size() const;
+  /** Return the statistics of the window, except for the average (0).  */
+  ByteStats stats() const;
+
+ private:
+  SlidingEntropy entropy_;
+  uint64_t printable_, zeros_;
+  // Sum of squared counts, for the chi-square statistic.
+  uint64_t squares_;
+};
+
+/**
+ * Split data into points of point_size (at least 1) bytes and store the
+ * entropy of each one (in bits) in out, which has room for points values.
+ * A point ends at the first byte i for which i / point_size reaches its
+ * index + 1, the last one takes all remaining bytes. Points with no bytes
+ * are left untouched.
+ *
+ * Only points [first, last) are computed, so that parts of out can be
+ * filled in parallel (see parallelFor()).
+ */
+void entropyPerPoint(const uint8_t *data, size_t size, double point_size,
+                     size_t points, float *out, size_t first = 0,
+                     size_t last = SIZE_MAX);
+
+/**
+ * Store in out the average byte value (rounded down) of every point, with
+ * points as in entropyPerPoint().
+ */
+void averagePerPoint(const uint8_t *data, size_t size, double point_size,
+                     size_t points, float *out, size_t first = 0,
+                     size_t last = SIZE_MAX);
+
+/**
+ * Store in out the entropy (in bits) of a window of up to window + 1 bytes
+ * centered on the first byte of every point of point_size (at least 1)
+ * bytes. Suitable for points too small to have a meaningful entropy of
+ * their own. out must have room for size / point_size values, rounded up.
+ *
+ * Only points [first, last) are computed. Each range starts with a window
+ * filled from scratch, so ranges can be computed in parallel.
+ */
+void slidingEntropyPerPoint(const uint8_t *data, size_t size,
+                            double point_size, size_t window, float *out,
+                            size_t first = 0, size_t last = SIZE_MAX);
+
+/**
+ * Store ByteStats of every point in out, with points as in
+ * entropyPerPoint(). All the statistics come from a single pass over the
+ * data.
+ */
+void statsPerPoint(const uint8_t *data, size_t size, double point_size,
+                   size_t points, ByteStats *out, size_t first = 0,
+                   size_t last = SIZE_MAX);
+
+/**
+ * Store in out ByteStats of windows centered on every point, as in
+ * slidingEntropyPerPoint(), except for the average - which is that of the
+ * point's own bytes, with points split as in averagePerPoint(). out must
+ * have room for points values and for size / point_size values, rounded
+ * up.
+ *
+ * Only points [first, last) are computed, see slidingEntropyPerPoint().
+ */
+void slidingStatsPerPoint(const uint8_t *data, size_t size,
+                          double point_size, size_t points, size_t window,
+                          ByteStats *out, size_t first = 0,
+                          size_t last = SIZE_MAX);
+
+}  // namespace util
+}  // namespace veles
+
+#endif
@@ -24,7 +24,7 @@ namespace util {
 
 class FakeSampler : public ISampler {
  public:
-  explicit FakeSampler(const QByteArray &data) : ISampler(data) {}
+  explicit FakeSampler(const data::PieceTable &data) : ISampler(data) {}
   FakeSampler* clone() override;
  protected:
   size_t getRealSampleSize() override;
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef IMPORTANCE_SAMPLER_H
+#define IMPORTANCE_SAMPLER_H
+
+#include <memory>
+#include <vector>
+#include "util/sampling/isampler.h"
+
+namespace veles {
+namespace util {
+
+/**
+ * Sampler which spends its budget non-uniformly: the input is split into
+ * blocks, each block gets a cheap entropy estimate (from a few short probes)
+ * and the windows of the sample are distributed between blocks in
+ * proportion to it. Low-entropy areas, like zero padding, still get some
+ * windows (see MIN_WEIGHT), so they remain visible, but most of the sample
+ * shows the structured parts of the input.
+ *
+ * Windows are aligned to multiples of the window size within the range and
+ * never overlap, and the sample keeps them in file order, so the sample /
+ * file offset mappings stay monotonic.
+ */
+class ImportanceSampler : public ISampler {
+ public:
+  explicit ImportanceSampler(const data::PieceTable &data);
+  ~ImportanceSampler();
+
+  ImportanceSampler* clone() override;
+ private:
+  static const size_t MAX_BLOCKS = 0x4000;
+  static const size_t PROBES = 4;
+  static const size_t PROBE_SIZE = 64;
+  // Weight of a block with zero entropy, relative to 8 (the weight of
+  // a block of random bytes).
+  static constexpr double MIN_WEIGHT = 0.25;
+
+  ImportanceSampler(const ImportanceSampler& other);
+  void initialiseSample(size_t size) override;
+  char getSampleByte(size_t index) override;
+  const char* getData() override;
+  size_t getRealSampleSize() override;
+  size_t getFileOffsetImpl(size_t index) override;
+  size_t getSampleOffsetImpl(size_t address) override;
+  void resampleImpl() override;
+
+  /**
+   * Estimate the entropy (in bits per byte) of size bytes at start of the
+   * input from PROBES evenly spread probes.
+   */
+  double estimateEntropy(size_t start, size_t size);
+
+  size_t window_size_;
+  std::vector<size_t> windows_;
+  std::shared_ptr<const char> buffer_;
+};
+
+}  // namespace util
+}  // namespace veles
+
+#endif
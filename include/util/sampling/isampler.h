@@ -17,16 +17,54 @@
 #ifndef ISAMPLER_H
 #define ISAMPLER_H
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <utility>
-#include <QByteArray>
+
+#include <vector>
+
+#include "data/bindata.h"
+#include "data/piecetable.h"
+#include "data/repack.h"
+#include "util/sampling/sample_cache.h"
 
 namespace veles {
 namespace util {
 
+/**
+ * Counters describing the work done by a Sampler, see ISampler::getStats().
+ * Times are wall-clock nanoseconds.
+ */
+struct SamplerStats {
+  /** Number of times the sample was (re-)computed.  */
+  uint64_t initialisations;
+  uint64_t initialise_ns;
+  /** Number of data() calls and the time spent in them.  */
+  uint64_t data_calls;
+  uint64_t data_ns;
+  /** Octets of input read to build samples.  */
+  uint64_t bytes_read;
+  /** Lookups in the cache set with ISampler::setCache().  */
+  uint64_t cache_hits;
+  uint64_t cache_misses;
+};
+
 /**
  * Abstract interface for Sampler classes.
  * The idea is that any Sampler wraps a byte stream and performs sampling
  * to return a small, representative sample.
+ * The byte stream is a data::PieceTable, which can be bigger than 4GB
+ * (eg. a memory-mapped disk image, or an edited blob made of many pieces;
+ * a plain data::BinData converts to it implicitly). Its elements can be of
+ * any width up to 64 bits, or the input can be reinterpreted with
+ * setElementFormat(); the sample always consists of bytes, with elements
+ * normalized to 8 bits (see readData()). Offsets and ranges are in
+ * elements.
+ * The Sampler keeps its own read-only copy of the input PieceTable.
+ * Copying a PieceTable only shares its pieces, so this costs no memory
+ * proportional to the data size, and the Sampler stays valid even if the
+ * caller drops, replaces or edits its PieceTable.
  * Specific sample size can be requested by user, but this is only treated
  * as a suggestion and the implementation may return a sample of different
  * size.
@@ -43,9 +81,26 @@ namespace util {
  */
 class ISampler {
  public:
-  explicit ISampler(const QByteArray &data);
+  explicit ISampler(const data::PieceTable &data);
   virtual ~ISampler() {}
 
+  /**
+   * Sample elements repacked from the input with the given format (see
+   * data::repack), eg. 12-bit packed values out of 8-bit data, instead of
+   * the input's own elements. Only the sampled parts of the input are ever
+   * repacked. Resets the range to all elements.
+   */
+  void setElementFormat(const data::RepackFormat &format);
+
+  /**
+   * Replace the input with data, which must have the same size and element
+   * width (eg. the input after an edit which didn't change its size). All
+   * settings are kept and the old input is released; the sample is read
+   * again from the new input upon next access. Invalidates all pointers
+   * previously returned by data() method.
+   */
+  void setData(const data::PieceTable &data);
+
   /**
    * Set the range of bytes from data to use as a base for sampling.
    * Bytes outside given range will be ignored. By default all data is used
@@ -86,6 +141,33 @@ class ISampler {
    */
   void setResampleTrigger(size_t sample_size);
 
+  /**
+   * Return the number of passes in which the sample can be prepared
+   * progressively. The sample of each pass is a superset of the previous
+   * one and the last pass gives the full sample, so a coarse version can be
+   * shown quickly and refined later. Returns 1 if the Sampler doesn't
+   * support progressive sampling.
+   */
+  size_t getPassesCount();
+
+  /**
+   * Limit the sample to the given pass (see getPassesCount()). By default,
+   * and for any pass >= getPassesCount() - 1, the full sample is used.
+   * May cause re-sampling, invalidates all pointers previously returned by
+   * data() method.
+   */
+  void setPass(size_t pass);
+
+  /**
+   * Set the seed for random choices made by the Sampler. Samplers are
+   * deterministic: the same seed and settings always give the same sample,
+   * so the seed can be persisted to reproduce a view. Clones keep the seed.
+   * May cause re-sampling, invalidates all pointers previously returned by
+   * data() method.
+   */
+  void setSeed(uint64_t seed);
+  uint64_t getSeed();
+
   /**
    * Take new sample from underlying file.
    * Invalidates all pointers previously returned by data() method.
@@ -138,6 +220,28 @@ class ISampler {
    */
   bool empty();
 
+  /**
+   * Set a flag which, once set (from any thread), makes the sampling in
+   * progress stop early. The Sampler is then left in an unusable state and
+   * should only be deleted. Pass nullptr to clear it. Clones don't inherit
+   * the flag. Used by AsyncSampler.
+   */
+  void setCancellationFlag(const std::atomic<bool> *flag);
+
+  /**
+   * Share a cache of computed samples with this Sampler. Clones use the same
+   * cache, so eg. going back to a range sampled before by any of them
+   * doesn't need re-sampling. Pass nullptr to stop using a cache.
+   */
+  void setCache(std::shared_ptr<SampleCache> cache);
+
+  /**
+   * Return counters of the work done by this Sampler so far (a clone starts
+   * from zero). Useful to tell slow sampling from slow rendering.
+   */
+  const SamplerStats& getStats();
+  void resetStats();
+
   virtual ISampler* clone() = 0;
 
  protected:
@@ -164,6 +268,37 @@ class ISampler {
 
   bool isInitialised();
 
+  /**
+   * Return the pass set with setPass().
+   */
+  size_t getPass();
+
+  /**
+   * Return true if sampling should be aborted (see setCancellationFlag).
+   * Implementations doing lengthy work should check it every now and then.
+   */
+  bool isCancelled();
+
+  /**
+   * Return the cache key identifying the sample for the current input,
+   * range, requested sample size and pass. Implementations fill in the
+   * remaining parameters they depend on.
+   */
+  SampleCache::Key getCacheKey();
+
+  /**
+   * Return the sample stored under key in the cache set with setCache(),
+   * or nullptr if there's none (or no cache is used).
+   */
+  std::shared_ptr<const SampleCache::Sample> findCachedSample(
+      const SampleCache::Key &key);
+
+  /**
+   * Store the sample under key in the cache set with setCache(), if any.
+   */
+  void cacheSample(const SampleCache::Key &key,
+                   std::shared_ptr<const SampleCache::Sample> sample);
+
   /**
    * Return the size of sample requested by user (with setSampleSize).
    */
@@ -178,9 +313,19 @@ class ISampler {
 
   /**
    * Return the input data as simple array. Size of array is getDataSize().
+   * Unless the input is plain bytes and the range lies within a single
+   * piece, this has to normalize (and copy) the whole range - use
+   * readData() for parts of it instead.
    */
   const char* getRawData();
 
+  /**
+   * Copy count elements of input data starting at index (indexed as for
+   * getDataByte()) to out, normalized to bytes: wider elements are reduced
+   * to their 8 most significant bits, narrower ones are scaled up.
+   */
+  void readData(size_t index, size_t count, char *out);
+
   ISampler(const ISampler& other);
 
  private:
@@ -219,12 +364,37 @@ class ISampler {
    */
   virtual void resampleImpl() = 0;
 
+  /**
+   * Implementation of getPassesCount public method, for a sample of given
+   * size. Only Samplers supporting progressive sampling need to override it.
+   */
+  virtual size_t getPassesCountImpl(size_t size);
+
+  /**
+   * Implementation of setData public method, called once the input is
+   * replaced. By default the Sampler is re-initialised - Samplers whose
+   * choice of windows doesn't depend on the input can keep them and only
+   * drop the copied sample.
+   */
+  virtual void setDataImpl();
+
   void init();
   size_t samplingRequired();
-
-  const QByteArray &data_;
-  size_t start_, end_, sample_size_, resample_trigger_;
+  bool isByteInput();
+
+  data::PieceTable data_;
+  data::RepackFormat format_;
+  bool repack_;
+  // Number of input elements.
+  size_t size_;
+  // Normalized copy of the range returned by getRawData(), if needed.
+  std::vector<char> normalized_;
+  size_t start_, end_, sample_size_, resample_trigger_, pass_;
+  uint64_t seed_;
   bool initialised_;
+  const std::atomic<bool> *cancelled_;
+  std::shared_ptr<SampleCache> cache_;
+  SamplerStats stats_;
 };
 
 }  // namespace util
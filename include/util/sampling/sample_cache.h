@@ -0,0 +1,128 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef SAMPLE_CACHE_H
+#define SAMPLE_CACHE_H
+
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "data/piecetable.h"
+#include "data/repack.h"
+
+namespace veles {
+namespace util {
+
+/**
+ * Keeps recently computed samples, so that a Sampler asked for a sample it
+ * (or any of its clones) has already computed can reuse it instead of
+ * sampling again - eg. when navigating back and forth through minimap zoom
+ * levels.
+ *
+ * Samples are identified by the data they come from, the sampled range and
+ * all parameters affecting the result (see Key). The total size of cached
+ * samples is kept under a configurable cap by evicting the least recently
+ * used ones.
+ *
+ * A SampleCache is shared with ISampler::setCache(), clones of a Sampler
+ * share its cache. All methods are thread-safe.
+ */
+class SampleCache {
+ public:
+  struct Key {
+    /** Identity of the input - its PieceTable::version() and size.  */
+    const void *data;
+    size_t data_size;
+    /** Element format (see ISampler::setElementFormat()) - all zero for
+        native elements.  */
+    bool repack;
+    data::RepackEndian endian;
+    unsigned width, high_pad, low_pad;
+    size_t start, end;
+    size_t sample_size, window_size, pass;
+    uint64_t seed;
+
+    bool operator<(const Key &other) const;
+  };
+
+  struct Sample {
+    /** Offsets of the sampled windows.  */
+    std::vector<size_t> windows;
+    std::shared_ptr<const char> data;
+    size_t size;
+  };
+
+  static const size_t DEFAULT_MAX_SIZE = 64 * 1024 * 1024;
+
+  explicit SampleCache(size_t max_size = DEFAULT_MAX_SIZE);
+
+  /**
+   * Return the sample stored under key, or nullptr if there's none. The
+   * sample becomes the most recently used one.
+   */
+  std::shared_ptr<const Sample> find(const Key &key);
+
+  /**
+   * Store a sample of input under key, evicting the least recently used
+   * samples if needed. The cache keeps a (shared) copy of input, so that
+   * the identity in key stays valid as long as the sample is cached.
+   * Samples bigger than the cap aren't stored at all.
+   */
+  void insert(const Key &key, const data::PieceTable &input,
+              std::shared_ptr<const Sample> sample);
+
+  /**
+   * Drop all cached samples.
+   */
+  void clear();
+
+  /**
+   * Set the cap on the total size of cached samples (in bytes).
+   */
+  void setMaxSize(size_t max_size);
+  size_t maxSize();
+
+  /**
+   * Return the total size of cached samples (in bytes).
+   */
+  size_t size();
+
+ private:
+  struct Entry {
+    Key key;
+    data::PieceTable input;
+    std::shared_ptr<const Sample> sample;
+  };
+  typedef std::list<Entry> EntryList;
+
+  static size_t sampleSize(const Sample &sample);
+  void evict(size_t max_size);
+
+  std::mutex mutex_;
+  // Most recently used first.
+  EntryList entries_;
+  std::map<Key, EntryList::iterator> index_;
+  size_t size_, max_size_;
+};
+
+}  // namespace util
+}  // namespace veles
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef STATS_PYRAMID_H
+#define STATS_PYRAMID_H
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "data/piecetable.h"
+
+namespace veles {
+namespace util {
+
+/**
+ * Exact byte statistics (value histogram and sum) of any range of a blob,
+ * without sampling it.
+ *
+ * The input is split into blocks of getBlockSize() elements. Level 0 keeps
+ * a histogram and a sum for every block, each next level merges pairs of
+ * nodes of the previous one. Statistics of a range are then merged from
+ * O(log n) nodes, plus the elements of partially covered blocks at its
+ * edges - which can be avoided by aligning the range to blocks with
+ * alignOffset().
+ *
+ * Elements are normalized to bytes the same way ISampler does (wider
+ * elements are reduced to their 8 most significant bits, narrower ones are
+ * scaled up).
+ *
+ * The pyramid has to be computed with build() (which reads the whole
+ * input, so it's meant to be called in a background thread) before it can
+ * be queried. Once ready() returns true, query() can be called from any
+ * thread.
+ *
+ * Edits which don't change the size of the input are applied with
+ * update(), which only recomputes the blocks they touch and their
+ * ancestors.
+ *
+ * Example usage:
+ * StatsPyramid pyramid(data);
+ * pyramid.build();
+ * double average = pyramid.query(start, end, false).average();
+ */
+class StatsPyramid {
+ public:
+  struct Stats {
+    uint64_t count;
+    uint64_t sum;
+    /** Occurrences of every byte value - only filled if requested.  */
+    uint64_t histogram[256];
+
+    /** Return the average byte value, 0 for an empty range.  */
+    double average() const;
+    /** Return the Shannon entropy of the histogram, in bits (0 to 8).  */
+    double entropy() const;
+  };
+
+  static const size_t MIN_BLOCK_SIZE = 4096;
+  /** Caps the memory used by the pyramid (about 2KB per block).  */
+  static const size_t MAX_BLOCKS = 16384;
+
+  /**
+   * Create a pyramid for data. If block_size is 0, the smallest power of two
+   * not less than MIN_BLOCK_SIZE giving at most MAX_BLOCKS blocks is used.
+   */
+  explicit StatsPyramid(const data::PieceTable &data, size_t block_size = 0);
+
+  /**
+   * Compute the pyramid. Returns false if it was interrupted by setting
+   * cancelled (from any thread), in which case the pyramid stays unusable.
+   */
+  bool build(const std::atomic<bool> *cancelled = nullptr);
+
+  /**
+   * Return true once build() has completed.
+   */
+  bool ready() const;
+
+  /**
+   * Replace the input with data, which differs from the old one only in
+   * elements [start, end), and recompute the affected nodes - in time
+   * proportional to the edit (rounded to blocks) plus O(log n). Returns
+   * false if the pyramid isn't ready or data has a different size or
+   * width, in which case a new pyramid has to be built. Must not be called
+   * concurrently with query().
+   */
+  bool update(const data::PieceTable &data, size_t start, size_t end);
+
+  /**
+   * Return statistics of elements [start, end). The histogram is only
+   * computed if with_histogram is true - without it only O(log n) sums are
+   * added up. Must only be called once ready() returns true.
+   */
+  Stats query(size_t start, size_t end, bool with_histogram = true) const;
+
+  /**
+   * Return the block boundary nearest to offset. Ranges with both ends
+   * aligned are answered from the pyramid alone.
+   */
+  size_t alignOffset(size_t offset) const;
+
+  size_t getBlockSize() const;
+  size_t size() const;
+
+ private:
+  void computeBlock(size_t block);
+  // Recompute a node of level (> 0) from its children.
+  void mergeNode(size_t level, size_t node);
+  void countElements(size_t start, size_t end, Stats *stats,
+                     bool with_histogram) const;
+  void addNode(size_t level, size_t index, Stats *stats,
+               bool with_histogram) const;
+
+  data::PieceTable data_;
+  size_t block_size_;
+  // Counts are 32-bit, so levels end before a node would cover 4G elements.
+  std::vector<std::vector<uint32_t>> histograms_;
+  std::vector<std::vector<uint64_t>> sums_;
+  std::atomic<bool> ready_;
+};
+
+}  // namespace util
+}  // namespace veles
+
+#endif
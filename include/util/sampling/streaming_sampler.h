@@ -0,0 +1,66 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef STREAMING_SAMPLER_H
+#define STREAMING_SAMPLER_H
+
+#include <memory>
+#include <vector>
+#include "util/sampling/isampler.h"
+
+namespace veles {
+namespace util {
+
+/**
+ * Sampler which reads its input strictly sequentially, in blocks of
+ * BLOCK_SIZE bytes, and keeps a reservoir of uniformly chosen windows
+ * (reservoir sampling, "Algorithm L"). Window contents are copied when
+ * they're chosen, so memory use is bounded by the sample size and every
+ * part of the input is visited at most once, in order - which suits
+ * memory-mapped files much bigger than RAM, where random access means
+ * page faults all over the file.
+ *
+ * Windows are aligned to multiples of the window size within the range and
+ * the sample keeps them in file order, so getFileOffset / getSampleOffset
+ * work as for the other samplers.
+ */
+class StreamingSampler : public ISampler {
+ public:
+  explicit StreamingSampler(const data::PieceTable &data);
+  ~StreamingSampler();
+
+  StreamingSampler* clone() override;
+ private:
+  static const size_t BLOCK_SIZE = 0x100000;
+
+  StreamingSampler(const StreamingSampler& other);
+  void initialiseSample(size_t size) override;
+  char getSampleByte(size_t index) override;
+  const char* getData() override;
+  size_t getRealSampleSize() override;
+  size_t getFileOffsetImpl(size_t index) override;
+  size_t getSampleOffsetImpl(size_t address) override;
+  void resampleImpl() override;
+
+  size_t window_size_;
+  std::vector<size_t> windows_;
+  std::shared_ptr<const char> buffer_;
+};
+
+}  // namespace util
+}  // namespace veles
+
+#endif
@@ -17,6 +17,8 @@
 #ifndef UNIFORM_SAMPLER_H
 #define UNIFORM_SAMPLER_H
 
+#include <memory>
+#include <random>
 #include <vector>
 #include "util/sampling/isampler.h"
 
@@ -25,12 +27,33 @@ namespace util {
 
 class UniformSampler : public ISampler {
  public:
-  explicit UniformSampler(const QByteArray &data);
+  explicit UniformSampler(const data::PieceTable &data);
   ~UniformSampler();
 
   void setWindowSize(size_t size);
+
+  /**
+   * Enable progressive sampling (see ISampler::getPassesCount()). The first
+   * pass uses about MIN_PASS_WINDOWS of the windows and every next pass
+   * doubles their number, ending with the full sample.
+   */
+  void setProgressive(bool progressive);
+
+  /**
+   * Enable incremental re-sampling: when the range shrinks (or moves within
+   * the previously sampled one), windows still inside it are kept - along
+   * with their already copied contents - and only the missing ones are
+   * chosen and read, so the cost is proportional to the change. The result
+   * is still deterministic for a given seed and sequence of ranges, but
+   * depends on that sequence. resample() forces a fresh sample.
+   */
+  void setIncremental(bool incremental);
   UniformSampler* clone() override;
  private:
+  // How many windows / bytes to process between checks of isCancelled().
+  static const size_t CANCELLATION_CHECK_INTERVAL = 0x10000;
+  static const size_t MIN_PASS_WINDOWS = 64;
+
   UniformSampler(const UniformSampler& other);
   void initialiseSample(size_t size) override;
   char getSampleByte(size_t index) override;
@@ -39,11 +62,31 @@ class UniformSampler : public ISampler {
   size_t getFileOffsetImpl(size_t index) override;
   size_t getSampleOffsetImpl(size_t address) override;
   void resampleImpl() override;
+  size_t getPassesCountImpl(size_t size) override;
+  void setDataImpl() override;
+  size_t windowSizeFor(size_t size);
+
+  /**
+   * Append count windows chosen uniformly from [start, start + length) to
+   * windows, in order. Returns false if cancelled.
+   */
+  bool chooseWindows(std::default_random_engine *generator, size_t start,
+                     size_t length, size_t count, std::vector<size_t> *windows);
+
+  /**
+   * Incremental mode: update windows_ (and the sample) for the new range,
+   * reusing the previous ones. Returns false if they can't be reused.
+   */
+  bool topUpWindows(const std::shared_ptr<const char> &previous_buffer);
+  void setSampledRange();
 
   size_t window_size_, windows_count_;
-  bool use_default_window_size_;
+  bool use_default_window_size_, progressive_, incremental_;
+  // The range (and window size) windows_ were chosen for.
+  size_t sampled_start_, sampled_end_, sampled_window_size_;
   std::vector<size_t> windows_;
-  char *buffer_;
+  std::shared_ptr<const char> buffer_;
+  SampleCache::Key cache_key_;
 };
 
 }  // namespace util
@@ -17,6 +17,10 @@
 #ifndef VELES_VISUALISATION_MINIMAP_H
 #define VELES_VISUALISATION_MINIMAP_H
 
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions_3_2_Core>
 #include <QOpenGLShaderProgram>
@@ -28,7 +32,9 @@
 #include <QPair>
 #include <QBasicTimer>
 
+#include "util/sampling/entropy.h"
 #include "util/sampling/isampler.h"
+#include "util/sampling/stats_pyramid.h"
 
 namespace veles {
 namespace visualisation {
@@ -44,19 +50,31 @@ class VisualisationMinimap : public QOpenGLWidget,
     BLUE
   };
 
+  // All modes are computed at once, switching between them only uploads
+  // another channel of the texture.
   enum class MinimapMode {
     VALUE,
-    ENTROPY
+    ENTROPY,
+    PRINTABLE,
+    ZEROS,
+    CHI_SQUARE
   };
 
   explicit VisualisationMinimap(QWidget *parent = 0);
   ~VisualisationMinimap();
 
   void setSampler(util::ISampler * sampler);
+  // Once ready, textures are computed exactly from the pyramid instead of
+  // from the sample. Takes effect on the next refresh().
+  void setStatsPyramid(std::shared_ptr<util::StatsPyramid> pyramid);
   void setRange(size_t start, size_t end, bool reset_selection = true);
   QPair<size_t, size_t> getSelectedRange();
   void setSelectedRange(size_t start_address, size_t end_address);
   void refresh(bool has_context = false);
+  // Recompute the pixels affected by a change of elements [start, end) in
+  // the stats pyramid's data (see StatsPyramid::update()) and upload only
+  // the texture rows containing them.
+  void updateRange(size_t start, size_t end);
 
   void setMinimapColor(MinimapColor color);
   void setMinimapMode(MinimapMode mode);
@@ -102,22 +120,23 @@ class VisualisationMinimap : public QOpenGLWidget,
   size_t lineToOffset(float line_position);
   float offsetToLine(size_t offset);
 
-  static float* calculateAverageValueTexture(
-      const uint8_t *sample, size_t sample_size,
-      size_t texture_size, double point_size);
-  static float* calculateEntropyTexture(
+  static void calculateSampleStats(
       const uint8_t *sample, size_t sample_size,
-      size_t texture_size, double point_size);
+      size_t texture_size, double point_size, util::ByteStats *out);
 
-  static float* calculateEntropyTexturePerPixel(
-      const uint8_t *sample, size_t sample_size,
-      size_t texture_size, double point_size);
-  static float* calculateEntropyTextureSlidingWindow(
-      const uint8_t *sample, size_t sample_size,
-      size_t texture_size, double point_size);
-  static float* calculateEntropyTextureSingleWindow(
+  void calculateExactStats(size_t texture_size);
+  void calculateExactPixels(std::pair<size_t, size_t> range, size_t first,
+                            size_t last, util::ByteStats *out);
+  static size_t pointsPerTask(double point_size);
+
+  static void calculateSingleWindowEntropy(
       const uint8_t *sample, size_t sample_size,
-      size_t texture_size, double point_size);
+      size_t texture_size, double point_size, util::ByteStats *out);
+
+  // Return the texel value (0 to 256) of stats in the current mode.
+  float channelValue(const util::ByteStats &stats);
+  // Upload the current mode's channel of pixel_stats_ to the texture.
+  void uploadTexture();
 
   bool empty();
 
@@ -129,6 +148,9 @@ class VisualisationMinimap : public QOpenGLWidget,
   const float k_line_selection_epsilon = 0.003;
   const float k_minimum_line_distance = 0.02;
   static const int k_minimum_entropy_window = 256;
+  // Smallest parts of a texture computed by a single thread.
+  static const int k_min_bytes_per_task = 64 * 1024;
+  static const int k_exact_pixels_per_task = 64;
   const int k_bar_height = 7;
   const int k_bar_texture_width = 100;
   const float k_line_comparison_epsilon = 0.1;
@@ -138,6 +160,13 @@ class VisualisationMinimap : public QOpenGLWidget,
   bool initialised_;
   bool gl_initialised_;
   util::ISampler *sampler_;
+  std::shared_ptr<util::StatsPyramid> stats_pyramid_;
+  // Pixel i of a texture computed from the pyramid covers elements
+  // [exact_boundaries_[i], exact_boundaries_[i + 1]). Empty if the texture
+  // was computed from the sample.
+  std::vector<size_t> exact_boundaries_;
+  // Statistics of every pixel of the texture, in all modes.
+  std::vector<util::ByteStats> pixel_stats_;
 
   QBasicTimer timer;
 
@@ -17,13 +17,19 @@
 #ifndef VELES_VISUALISATION_MINIMAP_PANEL_H
 #define VELES_VISUALISATION_MINIMAP_PANEL_H
 
+#include <atomic>
+#include <memory>
+
 #include <QBoxLayout>
 #include <QPair>
 #include <QPushButton>
 #include <QSpacerItem>
+#include <QThreadPool>
 #include <QVector>
 
 #include "util/sampling/isampler.h"
+#include "util/sampling/sample_cache.h"
+#include "util/sampling/stats_pyramid.h"
 #include "visualisation/minimap.h"
 #include "visualisation/selectrangedialog.h"
 
@@ -37,7 +43,12 @@ class MinimapPanel : public QWidget {
   explicit MinimapPanel(QWidget *parent = 0);
   ~MinimapPanel();
 
-  void setSampler(util::ISampler *sampler);
+  void setSampler(util::ISampler *sampler, const data::PieceTable &data);
+  // Apply an edit of elements [start, end) of data which didn't change its
+  // size, redrawing only the affected parts of the minimaps. Returns false
+  // if it can't be done incrementally (the stats pyramid isn't ready yet),
+  // in which case setSampler() has to be called instead.
+  bool updateData(const data::PieceTable &data, size_t start, size_t end);
   QPair<size_t, size_t> getSelection();
 
  signals:
@@ -50,13 +61,23 @@ class MinimapPanel : public QWidget {
   void updateSelection(int minimap_index, size_t start, size_t end);
   void showSelectRangeDialog();
   void selectRange();
+  void statsPyramidReady();
 
  private:
   void initLayout();
   VisualisationMinimap::MinimapColor getMinimapColor();
+  QString getMinimapModeName();
 
   util::ISampler *sampler_;
   QVector<util::ISampler*> minimap_samplers_;
+  // Shared by all minimap samplers, so that going back to a zoom level
+  // doesn't need re-sampling.
+  std::shared_ptr<util::SampleCache> sample_cache_;
+  // Exact statistics of data, computed in the background and used by all
+  // minimaps once ready.
+  std::shared_ptr<util::StatsPyramid> stats_pyramid_;
+  std::shared_ptr<std::atomic<bool>> stats_pyramid_cancelled_;
+  QThreadPool stats_pyramid_pool_;
   QVector<VisualisationMinimap*> minimaps_;
   QVector<QSpacerItem*> minimap_spacers_;
 
@@ -27,6 +27,8 @@
 
 #include <map>
 
+#include "data/piecetable.h"
+#include "util/sampling/async_sampler.h"
 #include "visualisation/base.h"
 #include "visualisation/minimap_panel.h"
 
@@ -40,7 +42,11 @@ class VisualisationPanel : public QWidget {
   explicit VisualisationPanel(QWidget *parent = 0);
   ~VisualisationPanel();
 
-  void setData(const QByteArray &data);
+  void setData(const data::PieceTable &data);
+  // Like setData(), for data which differs from the current one only in
+  // elements [start, end). Edits which don't change the size are applied
+  // without rebuilding the minimap.
+  void updateData(const data::PieceTable &data, size_t start, size_t end);
   void setRange(const size_t start, const size_t end);
 
  private slots:
@@ -48,9 +54,11 @@ class VisualisationPanel : public QWidget {
   void setSampleSize(int kilobytes);
   void showNGramVisualisation();
   void minimapSelectionChanged(size_t start, size_t end);
+  void sampleReady(util::ISampler *sampler);
 
  private:
-  enum class ESampler {NO_SAMPLER, UNIFORM_SAMPLER};
+  enum class ESampler {NO_SAMPLER, UNIFORM_SAMPLER, IMPORTANCE_SAMPLER,
+                       STREAMING_SAMPLER};
   enum class EVisualisation {NGRAM};
 
   static const std::map<QString, ESampler> k_sampler_map;
@@ -60,7 +68,7 @@ class VisualisationPanel : public QWidget {
   static const int k_minimap_sample_size = 4096;
 
   static util::ISampler* getSampler(ESampler type,
-                                    const QByteArray &data,
+                                    const data::PieceTable &data,
                                     int sample_size);
   static VisualisationWidget* getVisualisation(EVisualisation type,
                                                QWidget *parent = 0);
@@ -68,15 +76,23 @@ class VisualisationPanel : public QWidget {
 
   void setVisualisation(EVisualisation type);
   void refreshVisualisation();
+  void requestSample(size_t start, size_t end);
+  // Sampling / refresh times for the veles.visualisation.sampling log.
+  void logSamplerStats(util::ISampler *sampler, qint64 refresh_ns);
   void initLayout();
   void initOptionsPanel();
   QBoxLayout* prepareVisualisationOptions();
 
-  QByteArray data_;
+  data::PieceTable data_;
   ESampler sampler_type_;
   EVisualisation visualisation_type_;
   int sample_size_;
   util::ISampler *sampler_, *minimap_sampler_;
+  // Type and input of sampler_, and of the last requested sample (which
+  // replaces sampler_ once ready), to tell if sampler_ can be cloned.
+  ESampler sampled_type_, requested_type_;
+  const void *sampled_version_, *requested_version_;
+  util::AsyncSampler *async_sampler_;
   MinimapPanel *minimap_;
   VisualisationWidget *visualisation_;
 
@@ -16,11 +16,60 @@
  */
 #include "data/bindata.h"
 #include <QtGlobal>
+#include <QtEndian>
+#include <QFile>
 #include <algorithm>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VELES_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace veles {
 namespace data {
 
+namespace {
+
+/** Copies a range of bits by sub-octet steps.  This is the slow path,
+    used only for the unaligned head and tail of a range.  */
+void copyBitsBitwise(uint8_t *dst,
+                     unsigned dst_bit,
+                     const uint8_t *src,
+                     unsigned src_bit,
+                     unsigned num_bits) {
+  while (num_bits) {
+    unsigned cur_bits = std::min(std::min(8 - src_bit, 8 - dst_bit), num_bits);
+    uint8_t mask = (1 << cur_bits) - 1;
+    uint8_t bits = (*src >> src_bit) & mask;
+    *dst &= ~(mask << dst_bit);
+    *dst |= bits << dst_bit;
+    src_bit += cur_bits;
+    dst_bit += cur_bits;
+    num_bits -= cur_bits;
+    if (src_bit == 8) {
+      src++;
+      src_bit = 0;
+    }
+    if (dst_bit == 8) {
+      dst++;
+      dst_bit = 0;
+    }
+  }
+}
+
+/** Returns 64 bits starting at bit src_bit (0-7) of src.  Reads 8 octets
+    if src_bit is 0, 9 octets otherwise.  */
+inline uint64_t loadBits64(const uint8_t *src, unsigned src_bit) {
+  uint64_t res = qFromLittleEndian<quint64>(src) >> src_bit;
+  if (src_bit)
+    res |= static_cast<uint64_t>(src[8]) << (64 - src_bit);
+  return res;
+}
+
+}
+
 void BinData::copyBits(uint8_t *dst,
                        unsigned dst_bit,
                        const uint8_t *src,
@@ -30,32 +79,93 @@ void BinData::copyBits(uint8_t *dst,
   src += src_bit >> 3;
   dst_bit &= 7;
   src_bit &= 7;
-  while (num_bits) {
-    if (src_bit == 0 && dst_bit == 0 && num_bits >= 8) {
+  // Align the destination to an octet boundary.
+  if (dst_bit && num_bits) {
+    unsigned cur_bits = std::min(8 - dst_bit, num_bits);
+    copyBitsBitwise(dst, dst_bit, src, src_bit, cur_bits);
+    dst++;
+    src_bit += cur_bits;
+    src += src_bit >> 3;
+    src_bit &= 7;
+    num_bits -= cur_bits;
+  }
+  if (src_bit == 0) {
+    unsigned cur_bytes = num_bits >> 3;
+    memcpy(dst, src, cur_bytes);
+    dst += cur_bytes;
+    src += cur_bytes;
+    num_bits &= 7;
+  } else {
+    // Funnel shift: each destination octet is made of the high bits of
+    // one source octet and the low bits of the next one.  As long as at
+    // least 64 (or 128) bits are left, the source has at least 9 (or 17)
+    // octets left, so the loads below never read past the range.
+#ifdef VELES_HAVE_SSE2
+    __m128i right = _mm_cvtsi32_si128(src_bit);
+    __m128i left = _mm_cvtsi32_si128(8 - src_bit);
+    while (num_bits >= 128) {
+      __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+      __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 1));
+      __m128i res = _mm_or_si128(_mm_srl_epi64(lo, right),
+                                 _mm_sll_epi64(hi, left));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), res);
+      dst += 16;
+      src += 16;
+      num_bits -= 128;
+    }
+#endif
+    while (num_bits >= 64) {
+      qToLittleEndian<quint64>(loadBits64(src, src_bit), dst);
+      dst += 8;
+      src += 8;
+      num_bits -= 64;
+    }
+    // Less than 64 bits left - do the remaining whole octets through
+    // a bounce buffer, to avoid reading past the range.
+    if (num_bits >= 8) {
+      uint8_t buf[9] = { 0 };
+      memcpy(buf, src, (src_bit + num_bits + 7) >> 3);
+      uint8_t res[8];
+      qToLittleEndian<quint64>(loadBits64(buf, src_bit), res);
       unsigned cur_bytes = num_bits >> 3;
-      memcpy(dst, src, cur_bytes);
+      memcpy(dst, res, cur_bytes);
       dst += cur_bytes;
       src += cur_bytes;
-      num_bits -= cur_bytes << 3;
-    } else {
-      unsigned cur_bits = std::min(std::min(8 - src_bit, 8 - dst_bit), num_bits);
-      uint8_t mask = (1 << cur_bits) - 1;
-      uint8_t bits = (*src >> src_bit) & mask;
-      *dst &= ~(mask << dst_bit);
-      *dst |= bits << dst_bit;
-      src_bit += cur_bits;
-      dst_bit += cur_bits;
-      num_bits -= cur_bits;
-      if (src_bit == 8) {
-        src++;
-        src_bit = 0;
-      }
-      if (dst_bit == 8) {
-        dst++;
-        dst_bit = 0;
-      }
+      num_bits &= 7;
     }
   }
+  copyBitsBitwise(dst, 0, src, src_bit, num_bits);
+}
+
+BinData BinData::fromFile(const QString &path, bool *ok) {
+  QFile *file = new QFile(path);
+  if (!file->open(QIODevice::ReadOnly)) {
+    delete file;
+    if (ok)
+      *ok = false;
+    return BinData();
+  }
+  if (ok)
+    *ok = true;
+  qint64 size = file->size();
+  uint8_t *map = nullptr;
+  if (!isInline(8, size) &&
+      static_cast<quint64>(size) <= std::numeric_limits<size_t>::max())
+    map = file->map(0, size);
+  if (!map) {
+    // Small, special (pipes, procfs) or otherwise unmappable file - just
+    // read it.
+    QByteArray bytes = file->readAll();
+    delete file;
+    return BinData(8, bytes.size(),
+                   reinterpret_cast<const uint8_t *>(bytes.constData()));
+  }
+  // The mapping lives as long as anybody refers to it.
+  std::shared_ptr<uint8_t> storage(map, [file] (uint8_t *ptr) {
+    file->unmap(ptr);
+    delete file;
+  });
+  return BinData(8, size, storage, map, true);
 }
 
 QString BinData::toString(size_t maxElements) {
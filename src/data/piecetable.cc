@@ -0,0 +1,264 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "data/piecetable.h"
+#include <algorithm>
+#include <atomic>
+
+namespace veles {
+namespace data {
+
+struct PieceTable::Node {
+  BinData data;
+  NodePtr left;
+  NodePtr right;
+  /** Heap priority - never lower than the priorities of the children,
+      which keeps the tree balanced with high probability.  */
+  uint64_t priority;
+  /** Number of elements in this subtree.  */
+  uint64_t size;
+  /** Number of pieces in this subtree.  */
+  size_t count;
+};
+
+namespace {
+
+uint64_t nextPriority() {
+  // splitmix64 over a counter - deterministic, well spread, and safe to
+  // use from any thread.
+  static std::atomic<uint64_t> counter(0);
+  uint64_t x = counter.fetch_add(1, std::memory_order_relaxed);
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+BinData concat(const BinData &a, const BinData &b) {
+  BinData res(a.width(), a.size() + b.size());
+  res.setData(0, a.size(), a);
+  res.setData(a.size(), res.size(), b);
+  return res;
+}
+
+}
+
+PieceTable::PieceTable(const BinData &data) : width_(data.width()) {
+  if (data.size())
+    root_ = makeLeaf(data);
+}
+
+uint64_t PieceTable::size() const {
+  return root_ ? root_->size : 0;
+}
+
+size_t PieceTable::pieceCount() const {
+  return root_ ? root_->count : 0;
+}
+
+PieceTable::NodePtr PieceTable::makeNode(const BinData &data,
+                                         const NodePtr &left,
+                                         const NodePtr &right,
+                                         uint64_t priority) {
+  auto node = std::make_shared<Node>();
+  node->data = data;
+  node->left = left;
+  node->right = right;
+  node->priority = priority;
+  node->size = data.size();
+  node->count = 1;
+  for (const NodePtr *child : {&left, &right}) {
+    if (*child) {
+      node->size += (*child)->size;
+      node->count += (*child)->count;
+    }
+  }
+  return node;
+}
+
+PieceTable::NodePtr PieceTable::makeLeaf(const BinData &data) {
+  return makeNode(data, nullptr, nullptr, nextPriority());
+}
+
+PieceTable::NodePtr PieceTable::merge(const NodePtr &left,
+                                      const NodePtr &right) {
+  if (!left)
+    return right;
+  if (!right)
+    return left;
+  if (left->priority >= right->priority)
+    return makeNode(left->data, left->left, merge(left->right, right),
+                    left->priority);
+  return makeNode(right->data, merge(left, right->left), right->right,
+                  right->priority);
+}
+
+std::pair<PieceTable::NodePtr, PieceTable::NodePtr> PieceTable::split(
+    const NodePtr &node, uint64_t pos) {
+  if (!node)
+    return std::make_pair(nullptr, nullptr);
+  if (pos == 0)
+    return std::make_pair(nullptr, node);
+  if (pos >= node->size)
+    return std::make_pair(node, nullptr);
+  uint64_t left_size = node->left ? node->left->size : 0;
+  uint64_t piece_end = left_size + node->data.size();
+  if (pos <= left_size) {
+    auto halves = split(node->left, pos);
+    return std::make_pair(halves.first,
+        makeNode(node->data, halves.second, node->right, node->priority));
+  }
+  if (pos >= piece_end) {
+    auto halves = split(node->right, pos - piece_end);
+    return std::make_pair(
+        makeNode(node->data, node->left, halves.first, node->priority),
+        halves.second);
+  }
+  // pos is inside this node's piece - both halves keep the node's
+  // priority, which is still at least the priorities of their children.
+  uint64_t off = pos - left_size;
+  return std::make_pair(
+      makeNode(node->data.data(0, off), node->left, nullptr, node->priority),
+      makeNode(node->data.data(off, node->data.size()), nullptr, node->right,
+               node->priority));
+}
+
+const BinData &PieceTable::firstPiece(const NodePtr &node) {
+  const Node *cur = node.get();
+  while (cur->left)
+    cur = cur->left.get();
+  return cur->data;
+}
+
+const BinData &PieceTable::lastPiece(const NodePtr &node) {
+  const Node *cur = node.get();
+  while (cur->right)
+    cur = cur->right.get();
+  return cur->data;
+}
+
+void PieceTable::collectPieces(const NodePtr &node, uint64_t start,
+                               uint64_t end, std::vector<BinData> *out) {
+  if (!node || start >= end)
+    return;
+  uint64_t left_size = node->left ? node->left->size : 0;
+  uint64_t piece_end = left_size + node->data.size();
+  if (start < left_size)
+    collectPieces(node->left, start, std::min(end, left_size), out);
+  if (start < piece_end && end > left_size)
+    out->push_back(node->data.data(std::max(start, left_size) - left_size,
+                                   std::min(end, piece_end) - left_size));
+  if (end > piece_end)
+    collectPieces(node->right, std::max(start, piece_end) - piece_end,
+                  end - piece_end, out);
+}
+
+BinData PieceTable::data(uint64_t start, uint64_t end) const {
+  assert(start <= end);
+  assert(end <= size());
+  if (start == end)
+    return BinData(width_, 0);
+  // Descend to the smallest subtree containing the whole range - if that
+  // is a single piece, no copy is needed.
+  const NodePtr *node = &root_;
+  while (true) {
+    uint64_t left_size = (*node)->left ? (*node)->left->size : 0;
+    uint64_t piece_end = left_size + (*node)->data.size();
+    if (end <= left_size) {
+      node = &(*node)->left;
+    } else if (start >= piece_end) {
+      start -= piece_end;
+      end -= piece_end;
+      node = &(*node)->right;
+    } else if (start >= left_size && end <= piece_end) {
+      return (*node)->data.data(start - left_size, end - left_size);
+    } else {
+      break;
+    }
+  }
+  std::vector<BinData> parts;
+  collectPieces(*node, start, end, &parts);
+  BinData res(width_, end - start);
+  size_t pos = 0;
+  for (const auto &part : parts) {
+    res.setData(pos, pos + part.size(), part);
+    pos += part.size();
+  }
+  return res;
+}
+
+std::vector<BinData> PieceTable::pieces(uint64_t start, uint64_t end) const {
+  assert(start <= end);
+  assert(end <= size());
+  std::vector<BinData> res;
+  collectPieces(root_, start, end, &res);
+  return res;
+}
+
+PieceTable PieceTable::slice(uint64_t start, uint64_t end) const {
+  assert(start <= end);
+  assert(end <= size());
+  return PieceTable(split(split(root_, end).first, start).second, width_);
+}
+
+uint64_t PieceTable::element64(uint64_t pos) const {
+  assert(pos < size());
+  const Node *node = root_.get();
+  while (true) {
+    uint64_t left_size = node->left ? node->left->size : 0;
+    if (pos < left_size) {
+      node = node->left.get();
+      continue;
+    }
+    pos -= left_size;
+    if (pos < node->data.size())
+      return node->data.element64(pos);
+    pos -= node->data.size();
+    node = node->right.get();
+  }
+}
+
+void PieceTable::replace(uint64_t start, uint64_t end, const BinData &data) {
+  assert(start <= end);
+  assert(end <= size());
+  assert(data.width() == width_);
+  auto head = split(root_, start);
+  NodePtr before = head.first;
+  NodePtr after = split(head.second, end - start).second;
+  // Merge the new data with small pieces around it, so that typing an
+  // element at a time doesn't create a piece per element.
+  BinData middle = data;
+  if (before) {
+    const BinData &last = lastPiece(before);
+    if (last.octets() + middle.octets() <= MERGE_OCTETS) {
+      middle = concat(last, middle);
+      before = split(before, before->size - last.size()).first;
+    }
+  }
+  if (after) {
+    const BinData &first = firstPiece(after);
+    if (first.octets() + middle.octets() <= MERGE_OCTETS) {
+      middle = concat(middle, first);
+      after = split(after, first.size()).second;
+    }
+  }
+  if (middle.size())
+    before = merge(before, makeLeaf(middle));
+  root_ = merge(before, after);
+}
+
+}
+}
@@ -15,7 +15,16 @@
  *
  */
 #include "data/repack.h"
+#include <QtEndian>
+#include <algorithm>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VELES_HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace veles {
 namespace data {
@@ -29,6 +38,102 @@ static size_t gcd(size_t a, size_t b) {
   return a;
 }
 
+namespace {
+
+/** Reverses octet order in every sizeof(T)-octet element of src.  */
+template<typename T>
+void swapOctetsScalar(uint8_t *dst, const uint8_t *src, size_t num_elements) {
+  for (size_t i = 0; i < num_elements; i++)
+    qToLittleEndian(qFromBigEndian<T>(src + i * sizeof(T)), dst + i * sizeof(T));
+}
+
+#ifdef VELES_HAVE_SSE2
+
+/** Swaps the two octets of every 16-bit lane.  */
+inline __m128i swapOctets16(__m128i x) {
+  return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+/** Reverses octet order in every T lane of a 128-bit vector.  Whole
+    16-bit words are moved around with shuffles first, then the octets
+    inside them are swapped.  */
+template<typename T> __m128i swapOctetsVector(__m128i x);
+
+template<> inline __m128i swapOctetsVector<quint16>(__m128i x) {
+  return swapOctets16(x);
+}
+
+template<> inline __m128i swapOctetsVector<quint32>(__m128i x) {
+  x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+  x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+  return swapOctets16(x);
+}
+
+template<> inline __m128i swapOctetsVector<quint64>(__m128i x) {
+  x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+  x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(0, 1, 2, 3));
+  return swapOctets16(x);
+}
+
+template<typename T>
+void swapOctets(uint8_t *dst, const uint8_t *src, size_t num_elements) {
+  const size_t per_vector = 16 / sizeof(T);
+  size_t i = 0;
+  for (; i + per_vector <= num_elements; i += per_vector) {
+    __m128i x = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(src + i * sizeof(T)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * sizeof(T)),
+                     swapOctetsVector<T>(x));
+  }
+  swapOctetsScalar<T>(dst + i * sizeof(T), src + i * sizeof(T),
+                      num_elements - i);
+}
+
+#else
+
+template<typename T>
+void swapOctets(uint8_t *dst, const uint8_t *src, size_t num_elements) {
+  swapOctetsScalar<T>(dst, src, num_elements);
+}
+
+#endif
+
+/** Repacks 8-bit source data into unpadded elements whose width is
+    a multiple of 8.  These are plain little- or big-endian integers,
+    so a little-endian repack is a straight copy of the octets and
+    a big-endian one only needs the octets of each element reversed.
+    Returns false if the format is not of this kind.  */
+bool repackOctets(uint8_t *dst, const uint8_t *src,
+                  const RepackFormat &format, size_t num_elements) {
+  if (format.lowPad != 0 || format.highPad != 0 || format.width % 8 != 0)
+    return false;
+  unsigned octets = format.width / 8;
+  if (format.endian == RepackEndian::LITTLE || octets == 1) {
+    memcpy(dst, src, num_elements * octets);
+    return true;
+  }
+  if (format.endian != RepackEndian::BIG)
+    abort();
+  switch (octets) {
+  case 2:
+    swapOctets<quint16>(dst, src, num_elements);
+    break;
+  case 4:
+    swapOctets<quint32>(dst, src, num_elements);
+    break;
+  case 8:
+    swapOctets<quint64>(dst, src, num_elements);
+    break;
+  default:
+    for (size_t i = 0; i < num_elements; i++)
+      std::reverse_copy(src + i * octets, src + (i + 1) * octets,
+                        dst + i * octets);
+  }
+  return true;
+}
+
+}
+
 unsigned repackUnit(unsigned src_width,
                     const RepackFormat &format) {
   unsigned res = format.paddedWidth() / gcd(format.paddedWidth(), src_width) * src_width;
@@ -53,19 +158,50 @@ size_t repackableSize(unsigned src_width,
   return bits / format.paddedWidth();
 }
 
+RepackCursor::RepackCursor(const PieceTable &src, const RepackFormat &format,
+                           size_t start, size_t num_elements,
+                           size_t batch_size)
+  : src_(src), format_(format), src_pos_(start), pos_(0) {
+  assert(start <= src.size());
+  size_ = std::min(num_elements,
+    repackableSize(src.width(), format, src.size() - start));
+  unsigned repack_unit = repackUnit(src.width(), format);
+  src_per_unit_ = repack_unit / src.width();
+  dst_per_unit_ = repack_unit / format.paddedWidth();
+  size_t units = std::max<size_t>(
+    (batch_size + dst_per_unit_ - 1) / dst_per_unit_, 1);
+  batch_size_ = units * dst_per_unit_;
+}
+
+BinData RepackCursor::next() {
+  size_t num_elements = std::min(batch_size_, size_ - pos_);
+  size_t src_end = std::min<size_t>(
+    src_pos_ + repackSize(src_.width(), format_, num_elements), src_.size());
+  BinData res = repack(src_.data(src_pos_, src_end), format_, 0, num_elements);
+  pos_ += num_elements;
+  if (!atEnd())
+    src_pos_ += num_elements / dst_per_unit_ * src_per_unit_;
+  return res;
+}
+
 BinData repack(const BinData &src,
                const RepackFormat &format,
                size_t start, size_t num_elements) {
-  unsigned repack_unit = repackUnit(src.width(), format);
-  unsigned src_per_unit = repack_unit / src.width();
-  unsigned dst_per_unit = repack_unit / format.paddedWidth();
-  BinData workspace(repack_unit, 1);
   assert(start <= src.size());
   num_elements = std::min(num_elements,
     repackableSize(src.width(), format, src.size() - start));
   BinData res(format.width, num_elements);
+  if (num_elements == 0)
+    return res;
   size_t src_end = start + repackSize(src.width(), format, num_elements);
   assert(src_end <= src.size());
+  if (src.width() == 8 &&
+      repackOctets(res.rawData(), src.rawData(start), format, num_elements))
+    return res;
+  unsigned repack_unit = repackUnit(src.width(), format);
+  unsigned src_per_unit = repack_unit / src.width();
+  unsigned dst_per_unit = repack_unit / format.paddedWidth();
+  BinData workspace(repack_unit, 1);
   for (size_t dst_pos = 0, src_pos = start; dst_pos < num_elements;) {
     for (unsigned i = 0; i < src_per_unit && src_pos < src_end; i++, src_pos++) {
       unsigned work_pos;
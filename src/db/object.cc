@@ -134,6 +134,15 @@ void RootLocalObject::runMethod(MethodRunner *runner, PMethodRequest req) {
   if (auto blobreq = req.dynamicCast<dbif::RootCreateFileBlobFromDataRequest>()) {
     PLocalObject obj = FileBlobObject::create(this, blobreq->data, blobreq->path);
     runner->sendResult<dbif::CreatedReply>(db()->handle(obj));
+  } else if (auto filereq = req.dynamicCast<dbif::RootCreateFileBlobFromFileRequest>()) {
+    bool ok;
+    data::BinData data = data::BinData::fromFile(filereq->path, &ok);
+    if (!ok) {
+      runner->sendError<dbif::FileOpenError>();
+      return;
+    }
+    PLocalObject obj = FileBlobObject::create(this, data, filereq->path);
+    runner->sendResult<dbif::CreatedReply>(db()->handle(obj));
   } else {
     LocalObject::runMethod(runner, req);
   }
@@ -147,7 +156,18 @@ void DataBlobObject::description_reply(InfoGetter *getter) {
 
 void DataBlobObject::data_reply(InfoGetter *getter, uint64_t start, uint64_t end) {
     end = std::min(end, uint64_t(data_.size()));
-    getter->sendInfo<dbif::BlobDataReply>(data_.data(start, end));
+    getter->sendInfo<dbif::BlobDataReply>(data_.slice(start, end));
+}
+
+void DataBlobObject::data_changed_reply(InfoGetter *getter, uint64_t start,
+                                        uint64_t end, uint64_t changed_start,
+                                        uint64_t changed_end) {
+    end = std::min(end, uint64_t(data_.size()));
+    changed_start = std::min(std::max(changed_start, start), end);
+    changed_end = std::max(std::min(changed_end, end), changed_start);
+    getter->sendInfo<dbif::BlobDataReply>(data_.slice(start, end),
+                                          changed_start - start,
+                                          changed_end - start);
 }
 
 void DataBlobObject::remove_data_watcher(InfoGetter *getter) {
@@ -187,21 +207,17 @@ void DataBlobObject::runMethod(MethodRunner *runner, PMethodRequest req) {
       runner->sendError<dbif::BlobDataInvalidWidthError>();
       return;
     }
-    if (oldsize == newdata.size()) {
-      data_.setData(start, end, newdata);
-    } else {
-      data::BinData merged(data_.width(), data_.size() - oldsize + newdata.size());
-      merged.setData(0, start, data_.data(0, start));
-      uint64_t newend = start + newdata.size();
-      merged.setData(start, newend, newdata);
-      merged.setData(newend, merged.size(), data_.data(end, data_.size()));
-      std::swap(data_, merged);
-    }
+    data_.replace(start, end, newdata);
     bool moved = newdata.size() != oldsize;
+    // Watchers are told which part of their range changed, so that views
+    // of big blobs can update only that. If the size changed, everything
+    // after the edit moved.
+    uint64_t changed_end = moved ? UINT64_MAX : start + newdata.size();
     for (auto iter = data_watchers_.begin(); iter != data_watchers_.end(); iter++) {
       if (iter.value().second >= start &&
           (moved || iter.value().first <= end)) {
-        data_reply(iter.key(), iter.value().first, iter.value().second);
+        data_changed_reply(iter.key(), iter.value().first,
+                           iter.value().second, start, changed_end);
       }
     }
     runner->sendResult<dbif::NullReply>();
@@ -54,9 +54,9 @@ int main(int argc, char **argv) {
   drep = blob->syncGetInfo<veles::dbif::DescriptionRequest>();
   qDebug() << "Name: " << drep->name;
   qDebug() << "Comment: " << drep->comment;
-  auto data = blob->syncGetInfo<veles::dbif::BlobDataRequest>(2, 5)->data;
-  qDebug() << "Data: " << QByteArray(reinterpret_cast<const char*>(data.rawData()), data.size());
-  data = blob->syncGetInfo<veles::dbif::BlobDataRequest>(7, 11)->data;
+  const auto data = blob->syncGetInfo<veles::dbif::BlobDataRequest>(2, 5)->data.data();
   qDebug() << "Data: " << QByteArray(reinterpret_cast<const char*>(data.rawData()), data.size());
+  const auto data2 = blob->syncGetInfo<veles::dbif::BlobDataRequest>(7, 11)->data.data();
+  qDebug() << "Data: " << QByteArray(reinterpret_cast<const char*>(data2.rawData()), data2.size());
   return 0;
 }
@@ -137,6 +137,7 @@ void FileBlobModel::gotBytesResponse(veles::dbif::PInfoReply reply) {
           reply.dynamicCast<dbif::BlobDataRequest::ReplyType>()) {
     binData_ = bytesReply->data;
     emit newBinData();
+    emit binDataChanged(bytesReply->changed_start, bytesReply->changed_end);
   }
 }
 
@@ -21,6 +21,8 @@
 #include <QPainter>
 #include <QScrollBar>
 
+#include <limits>
+
 #include "ui/hexedit.h"
 #include "util/encoders/factory.h"
 #include "util/settings/theme.h"
@@ -61,9 +63,12 @@ void HexEdit::recalculateValues() {
   lineWidth_ =
       startMargin_ + addressWidth_ + hexAreaWidth_ + asciiWidth_ + endMargin_;
 
-  verticalScrollBar()->setRange(0, rowsCount_ - rowsOnScreen_);
-  verticalScrollBar()->setPageStep(rowsOnScreen_);
-  startRow_ = verticalScrollBar()->value();
+  qint64 scrollRows = qMax(rowsCount_ - rowsOnScreen_, Q_INT64_C(0));
+  rowsPerScrollStep_ = scrollRows / std::numeric_limits<int>::max() + 1;
+  verticalScrollBar()->setRange(0, scrollRows / rowsPerScrollStep_);
+  verticalScrollBar()->setPageStep(
+      qMax(rowsOnScreen_ / rowsPerScrollStep_, Q_INT64_C(1)));
+  startRow_ = verticalScrollBar()->value() * rowsPerScrollStep_;
 
   horizontalScrollBar()->setRange(0, lineWidth_ - viewport()->width());
   startPosX_ = horizontalScrollBar()->value();
@@ -86,6 +91,7 @@ HexEdit::HexEdit(FileBlobModel *dataModel, QItemSelectionModel *selectionModel,
       autoBytesPerRow_(false),
       startOffset_(0),
       byteCharsCount_(0),
+      rowsPerScrollStep_(1),
       selectionStart_(0),
       selectionSize_(0) {
   setFont(util::settings::theme::font());
@@ -246,7 +252,7 @@ qint64 HexEdit::pointToBytePos(QPoint pos) {
 }
 
 qint64 HexEdit::byteValue(qint64 pos) {
-  return dataModel_->binData()[pos].element64();
+  return dataModel_->binData().element64(pos);
 }
 
 qint64 HexEdit::selectionStart() {
@@ -551,7 +557,7 @@ void HexEdit::copyToClipboard(util::encoders::Encoder *enc) {
   if (enc == nullptr) {
     enc = hexEncoder_.data();
   }
-  auto selectedData =
+  const auto selectedData =
       dataModel_->binData().data(selectionStart(), selectionEnd());
   QClipboard *clipboard = QApplication::clipboard();
   // TODO: convert encoders to use BinData
@@ -618,7 +624,7 @@ void HexEdit::scrollToByte(qint64 bytePos, bool doNothingIfVisable) {
     return;
   }
 
-  verticalScrollBar()->setValue(bytePos / bytesPerRow_);
+  verticalScrollBar()->setValue(bytePos / bytesPerRow_ / rowsPerScrollStep_);
   recalculateValues();
 
   viewport()->update();
@@ -646,7 +652,8 @@ void HexEdit::saveSelectionToFile(QString path) {
     size = dataBytesCount_ - byteOffset;
   }
 
-  auto dataToSave = dataModel_->binData().data(byteOffset, byteOffset + size);
+  const auto dataToSave =
+      dataModel_->binData().data(byteOffset, byteOffset + size);
 
   QFile file(path);
   if (!file.open(QIODevice::WriteOnly)) {
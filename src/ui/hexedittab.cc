@@ -235,8 +235,15 @@ bool HexEditTab::saveFile(const QString &fileName) {
 
   QFile file(tmpFileName);
   file.open(QIODevice::WriteOnly);
-  bool ok = file.write(QByteArray((const char *)dataModel->binData().rawData(),
-                                  dataModel->binData().size())) != -1;
+  const data::PieceTable &data = dataModel->binData();
+  bool ok = true;
+  for (const auto &piece : data.pieces(0, data.size())) {
+    if (file.write(reinterpret_cast<const char *>(piece.rawData()),
+                   piece.octets()) != static_cast<qint64>(piece.octets())) {
+      ok = false;
+      break;
+    }
+  }
   if (QFile::exists(fileName)) ok = QFile::remove(fileName);
   if (ok) {
     ok = file.copy(fileName);
@@ -272,8 +279,12 @@ bool HexEditTab::saveAs() {
 
 void HexEditTab::showVisualisation() {
   auto *panel = new visualisation::VisualisationPanel;
-  panel->setData(QByteArray((const char *)dataModel->binData().rawData(),
-                            dataModel->binData().size()));
+  panel->setData(dataModel->binData());
+  auto model = dataModel;
+  connect(model, &FileBlobModel::binDataChanged, panel,
+          [model, panel](uint64_t start, uint64_t end) {
+            panel->updateData(model->binData(), start, end);
+          });
   panel->setWindowTitle(curFilePath);
   panel->setAttribute(Qt::WA_DeleteOnClose);
 
@@ -19,9 +19,24 @@
 
 #include <QMessageBox>
 
+#include <algorithm>
+
 namespace veles {
 namespace ui {
 
+static bool matchesAt(const data::ElementReader &data, uint64_t index,
+                      const data::ElementReader &pattern) {
+  if (index + pattern.size() > data.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    if (pattern[i] != data[index + i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
 SearchDialog::SearchDialog(HexEdit *hexEdit, QWidget *parent)
     : QDialog(parent),
       ui(new Ui::SearchDialog),
@@ -35,22 +50,21 @@ SearchDialog::~SearchDialog() { delete ui; }
 
 qint64 SearchDialog::indexOf(const data::BinData &pattern, qint64 startPos) {
   // TODO: implement this as BinData method or as separate util
-  const data::BinData &data = _hexEdit->dataModel()->binData();
-  qint64 index = startPos;
+  const data::PieceTable &data = _hexEdit->dataModel()->binData();
+  data::ElementReader patternElements = pattern.elementReader();
+  uint64_t index = std::max(startPos, Q_INT64_C(0));
   while (index + pattern.size() <= data.size()) {
-    size_t numberOfMatches = 0;
-    while (numberOfMatches < pattern.size() &&
-           numberOfMatches + index < data.size() &&
-           pattern.element64(numberOfMatches) ==
-               data.element64(index + numberOfMatches)) {
-      ++numberOfMatches;
-    }
-
-    if (numberOfMatches == pattern.size()) {
-      return index;
+    uint64_t windowEnd =
+        std::min(data.size(), index + searchWindow_ + pattern.size());
+    const data::BinData window = data.data(index, windowEnd);
+    data::ElementReader windowElements = window.elementReader();
+    for (uint64_t i = 0;
+         i < searchWindow_ && i + pattern.size() <= window.size(); ++i) {
+      if (matchesAt(windowElements, i, patternElements)) {
+        return index + i;
+      }
     }
-
-    index++;
+    index += searchWindow_;
   }
 
   return -1;
@@ -59,25 +73,24 @@ qint64 SearchDialog::indexOf(const data::BinData &pattern, qint64 startPos) {
 qint64 SearchDialog::lastIndexOf(const data::BinData &pattern,
                                  qint64 startPos) {
   // TODO: implement this as BinData method or as separate util
-  const data::BinData &data = _hexEdit->dataModel()->binData();
-  if (startPos == -1) {
+  const data::PieceTable &data = _hexEdit->dataModel()->binData();
+  data::ElementReader patternElements = pattern.elementReader();
+  if (startPos == -1 || startPos > static_cast<qint64>(data.size())) {
     startPos = data.size();
   }
   qint64 index = startPos - 1;
   while (index > 0) {
-    size_t numberOfMatches = 0;
-    while (numberOfMatches < pattern.size() &&
-           numberOfMatches + index < data.size() &&
-           pattern.element64(numberOfMatches) ==
-               data.element64(index + numberOfMatches)) {
-      ++numberOfMatches;
-    }
-
-    if (numberOfMatches == pattern.size()) {
-      return index;
+    qint64 windowStart =
+        std::max(index - static_cast<qint64>(searchWindow_) + 1,
+                 Q_INT64_C(1));
+    const data::BinData window = data.data(
+        windowStart, std::min<uint64_t>(data.size(), index + pattern.size()));
+    data::ElementReader windowElements = window.elementReader();
+    for (; index >= windowStart; --index) {
+      if (matchesAt(windowElements, index - windowStart, patternElements)) {
+        return index;
+      }
     }
-
-    index--;
   }
 
   return -1;
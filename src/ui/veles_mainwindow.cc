@@ -586,27 +586,23 @@ void VelesMainWindow::createDb() {
 }
 
 void VelesMainWindow::createFileBlob(QString fileName) {
-  data::BinData data(8, 0);
+  dbif::MethodResultPromise *promise;
 
-  if (!fileName.isEmpty()) {
-    QFile file(fileName);
-    file.setFileName(fileName);
-    file.open(QIODevice::ReadOnly);
-    QByteArray bytes = file.readAll();
-    data = data::BinData(8, bytes.size(),
-                         reinterpret_cast<uint8_t *>(bytes.data()));
+  if (fileName.isEmpty()) {
+    promise = database->asyncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+        this, data::BinData(8, 0), fileName);
+  } else {
+    // The database maps the file itself, so that nothing is read here.
+    promise = database->asyncRunMethod<dbif::RootCreateFileBlobFromFileRequest>(
+        this, fileName);
   }
 
-  auto promise =
-      database->asyncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
-          this, data, fileName);
   connect(promise, &dbif::MethodResultPromise::gotResult, [this, fileName](
                                                               dbif::PMethodReply
                                                                   reply) {
     createHexEditTab(
         fileName.isEmpty() ? "untitled" : fileName,
-        reply.dynamicCast<dbif::RootCreateFileBlobFromDataRequest::ReplyType>()
-            ->object);
+        reply.dynamicCast<dbif::CreatedReply>()->object);
   });
 
   connect(promise, &dbif::MethodResultPromise::gotError,
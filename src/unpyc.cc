@@ -17,7 +17,6 @@
 #include <QCoreApplication>
 #include <QDebug>
 #include <QTimer>
-#include <QFile>
 #include "parser/unpyc.h"
 #include "db/db.h"
 #include "dbif/info.h"
@@ -30,15 +29,14 @@
 
 int main(int argc, char **argv) {
   QCoreApplication app(argc, argv);
-  QFile f(argv[1]);
-  bool ok = f.open(QIODevice::ReadOnly);
-  if (!ok)
-    return 1;
-  uint64_t size = f.size();
-  QByteArray qdata = f.read(size);
   veles::dbif::ObjectHandle obj = veles::db::create_db();
-  veles::data::BinData vec(8, qdata.size(), reinterpret_cast<uint8_t *>(qdata.data()));
-  auto blob = obj->syncRunMethod<veles::dbif::RootCreateFileBlobFromDataRequest>(vec, argv[1])->object;
+  veles::dbif::ObjectHandle blob;
+  try {
+    blob = obj->syncRunMethod<veles::dbif::RootCreateFileBlobFromFileRequest>(
+      QString(argv[1]))->object;
+  } catch (const veles::dbif::PError &) {
+    return 1;
+  }
   veles::parser::unpycFileBlob(blob);
   return 0;
 }
@@ -0,0 +1,76 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+
+#include "util/parallel.h"
+
+namespace veles {
+namespace util {
+
+namespace {
+
+// Chunks per thread, so that threads finishing early pick up the rest
+// instead of waiting for the slowest one.
+const size_t k_chunks_per_thread = 4;
+
+class ChunkTask : public QRunnable {
+ public:
+  ChunkTask(const std::function<void(size_t, size_t)> &body, size_t begin,
+            size_t end, QSemaphore *done) :
+      body_(body), begin_(begin), end_(end), done_(done) {}
+
+  void run() override {
+    body_(begin_, end_);
+    done_->release();
+  }
+
+ private:
+  const std::function<void(size_t, size_t)> &body_;
+  size_t begin_, end_;
+  QSemaphore *done_;
+};
+
+}  // namespace
+
+void parallelFor(size_t count, size_t min_chunk,
+                 const std::function<void(size_t, size_t)> &body) {
+  QThreadPool *pool = QThreadPool::globalInstance();
+  size_t threads = std::max(1, pool->maxThreadCount());
+  size_t chunks = std::min(threads * k_chunks_per_thread,
+                           count / std::max<size_t>(min_chunk, 1));
+  if (threads == 1 || chunks <= 1) {
+    if (count > 0) {
+      body(0, count);
+    }
+    return;
+  }
+
+  QSemaphore done;
+  for (size_t chunk = 1; chunk < chunks; ++chunk) {
+    pool->start(new ChunkTask(body, count * chunk / chunks,
+                              count * (chunk + 1) / chunks, &done));
+  }
+  body(0, count / chunks);
+  done.acquire(static_cast<int>(chunks - 1));
+}
+
+}  // namespace util
+}  // namespace veles
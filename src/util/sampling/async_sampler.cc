@@ -0,0 +1,158 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <QMetaObject>
+#include <QMutexLocker>
+#include <QRunnable>
+
+#include "util/sampling/async_sampler.h"
+
+namespace veles {
+namespace util {
+
+/*****************************************************************************/
+/* Worker task */
+/*****************************************************************************/
+
+class AsyncSampler::Task : public QRunnable {
+ public:
+  Task(AsyncSampler *owner, ISampler *sampler, uint64_t id,
+       std::shared_ptr<std::atomic<bool>> cancelled) :
+      owner_(owner), sampler_(sampler), id_(id), cancelled_(cancelled) {}
+  ~Task() {
+    delete sampler_;
+  }
+
+  void run() override {
+    // Coarse passes go to clones, so that the receiver can own them while
+    // the next pass is prepared.
+    size_t passes = sampler_->getPassesCount();
+    for (size_t pass = 0; pass + 1 < passes; ++pass) {
+      ISampler *coarse = sampler_->clone();
+      coarse->setPass(pass);
+      if (!prepare(coarse, false)) {
+        delete coarse;
+        return;
+      }
+    }
+    if (prepare(sampler_, true)) {
+      sampler_ = nullptr;
+    }
+  }
+
+ private:
+  /**
+   * Compute the sample and hand it over to the owner. Returns false (and
+   * keeps the ownership) if the request got cancelled in the meantime.
+   */
+  bool prepare(ISampler *sampler, bool complete) {
+    sampler->setCancellationFlag(cancelled_.get());
+    if (!sampler->empty() && sampler->getSampleSize() > 0) {
+      sampler->data();
+    }
+    sampler->setCancellationFlag(nullptr);
+
+    bool deliver = false;
+    {
+      QMutexLocker lock(&owner_->mutex_);
+      if (id_ == owner_->current_id_ && !*cancelled_) {
+        delete owner_->ready_;
+        owner_->ready_ = sampler;
+        owner_->ready_complete_ = complete;
+        deliver = true;
+      }
+    }
+    if (!deliver) {
+      return false;
+    }
+    QMetaObject::invokeMethod(owner_, "deliverSample", Qt::QueuedConnection);
+    return true;
+  }
+
+  AsyncSampler *owner_;
+  ISampler *sampler_;
+  uint64_t id_;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+/*****************************************************************************/
+/* Public methods */
+/*****************************************************************************/
+
+AsyncSampler::AsyncSampler(QObject *parent) :
+    QObject(parent), current_id_(0), ready_(nullptr),
+    ready_complete_(false) {}
+
+AsyncSampler::~AsyncSampler() {
+  cancel();
+  // Cancelled tasks finish quickly, and they still refer to this object.
+  pool_.waitForDone();
+  delete ready_;
+}
+
+void AsyncSampler::request(ISampler *sampler) {
+  auto cancelled = std::make_shared<std::atomic<bool>>(false);
+  uint64_t id;
+  {
+    QMutexLocker lock(&mutex_);
+    if (current_cancelled_) {
+      *current_cancelled_ = true;
+    }
+    delete ready_;
+    ready_ = nullptr;
+    id = ++current_id_;
+    current_cancelled_ = cancelled;
+  }
+  pool_.start(new Task(this, sampler, id, cancelled));
+}
+
+void AsyncSampler::cancel() {
+  QMutexLocker lock(&mutex_);
+  if (current_cancelled_) {
+    *current_cancelled_ = true;
+    current_cancelled_.reset();
+  }
+  delete ready_;
+  ready_ = nullptr;
+  ++current_id_;
+}
+
+bool AsyncSampler::busy() {
+  QMutexLocker lock(&mutex_);
+  return current_cancelled_ != nullptr;
+}
+
+/*****************************************************************************/
+/* Private slots */
+/*****************************************************************************/
+
+void AsyncSampler::deliverSample() {
+  ISampler *sampler;
+  {
+    QMutexLocker lock(&mutex_);
+    sampler = ready_;
+    ready_ = nullptr;
+    if (sampler != nullptr && ready_complete_) {
+      current_cancelled_.reset();
+    }
+  }
+  if (sampler != nullptr) {
+    emit sampleReady(sampler);
+  }
+}
+
+}  // namespace util
+}  // namespace veles
@@ -0,0 +1,467 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "util/sampling/entropy.h"
+
+namespace veles {
+namespace util {
+
+namespace {
+
+// Each of the 4 histograms of countBytes() gets at most a quarter of a
+// chunk, so 32-bit counters never overflow.
+const size_t k_count_chunk_size = size_t(1) << 31;
+
+// Points shorter than that are counted directly into the result histogram
+// and cleared by walking them again, which is cheaper than countBytes()
+// and 256 bins for a handful of bytes.
+const size_t k_short_point_size = 64;
+
+// Fixed point scale of SlidingEntropy sums, leaving room for windows of up
+// to 4G bytes.
+const double k_sliding_scale = 1 << 24;
+
+double pointEntropy(const uint8_t *data, size_t size, uint64_t *counts,
+                    const NLogNTable &table) {
+  if (size == 0) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  if (size < k_short_point_size) {
+    for (size_t i = 0; i < size; ++i) {
+      counts[data[i]] += 1;
+    }
+    for (size_t i = 0; i < size; ++i) {
+      uint64_t count = counts[data[i]];
+      if (count != 0) {
+        sum += table(count);
+        counts[data[i]] = 0;
+      }
+    }
+  } else {
+    countBytes(data, size, counts);
+    for (int value = 0; value < 256; ++value) {
+      sum += table(counts[value]);
+    }
+    memset(counts, 0, 256 * sizeof(*counts));
+  }
+  return std::log2(static_cast<double>(size)) - sum / size;
+}
+
+uint8_t pointAverage(const uint8_t *data, size_t size) {
+  uint64_t sum = 0;
+  for (size_t i = 0; i < size; ++i) {
+    sum += data[i];
+  }
+  return static_cast<uint8_t>(sum / size);
+}
+
+bool isPrintable(uint8_t value) {
+  return (value >= 0x20 && value < 0x7f) || value == '\t' ||
+         value == '\n' || value == '\r';
+}
+
+// isPrintable() of every byte value, so that it doesn't branch.
+struct PrintableTable {
+  uint8_t printable[256];
+  PrintableTable() {
+    for (int value = 0; value < 256; ++value) {
+      printable[value] = isPrintable(value);
+    }
+  }
+};
+
+const PrintableTable k_printable_table;
+
+// Entropy of a histogram of total bytes, given the sum of n * log2(n) over
+// its counts.
+double histogramEntropy(uint64_t total, double nlogn) {
+  return std::log2(static_cast<double>(total)) - nlogn / total;
+}
+
+// Derive ByteStats of total bytes from sums over their histogram: of byte
+// values, of printable and zero bytes and of squared counts.
+ByteStats finishStats(uint64_t total, uint64_t sum, uint64_t printable,
+                      uint64_t zeros, double entropy, double squares) {
+  ByteStats stats = ByteStats();
+  if (total == 0) {
+    return stats;
+  }
+  double count = static_cast<double>(total);
+  stats.average = static_cast<uint8_t>(sum / total);
+  stats.entropy = static_cast<float>(entropy);
+  stats.printable = static_cast<float>(printable / count);
+  stats.zeros = static_cast<float>(zeros / count);
+  // sum((n - E)^2 / E) with E = total / 256, over its maximum.
+  stats.chi_square = static_cast<float>(std::max(
+      0.0, (256.0 * squares / (count * count) - 1.0) / 255.0));
+  return stats;
+}
+
+// ByteStats counterpart of pointEntropy().
+ByteStats pointStats(const uint8_t *data, size_t size, uint64_t *counts,
+                     const NLogNTable &table) {
+  if (size >= k_short_point_size) {
+    countBytes(data, size, counts);
+    ByteStats stats = byteStats(counts, size, table);
+    memset(counts, 0, 256 * sizeof(*counts));
+    return stats;
+  }
+  uint64_t sum = 0, printable = 0, zeros = 0;
+  for (size_t i = 0; i < size; ++i) {
+    counts[data[i]] += 1;
+    sum += data[i];
+    printable += k_printable_table.printable[data[i]];
+    zeros += data[i] == 0;
+  }
+  double nlogn = 0.0, squares = 0.0;
+  for (size_t i = 0; i < size; ++i) {
+    uint64_t count = counts[data[i]];
+    if (count != 0) {
+      nlogn += table(count);
+      squares += static_cast<double>(count) * count;
+      counts[data[i]] = 0;
+    }
+  }
+  return finishStats(size, sum, printable, zeros,
+                     histogramEntropy(size, nlogn), squares);
+}
+
+// Return the first byte i for which floor(i / point_size) reaches point.
+size_t pointStart(size_t point, double point_size) {
+  size_t start = static_cast<size_t>(std::ceil(point * point_size));
+  while (start > 0 && std::floor((start - 1) / point_size) >= point) {
+    --start;
+  }
+  while (std::floor(start / point_size) < point) {
+    ++start;
+  }
+  return start;
+}
+
+// Call process(index, begin, end) with the bytes [begin, end) of each of
+// points [first, last), split as described for entropyPerPoint().
+template <typename Process>
+void forEachPoint(size_t size, double point_size, size_t points,
+                  size_t first, size_t last, Process process) {
+  last = std::min(last, points);
+  // Point index ends at the first byte i with i / point_size >= index + 1.
+  size_t start = (first == 0) ? 0 : pointStart(first, point_size) + 1;
+  for (size_t index = first; index < last && start < size; ++index) {
+    // Last byte of the point.
+    size_t end;
+    if (index == points - 1) {
+      end = size - 1;
+      if (static_cast<double>(end) / point_size < index + 1) break;
+    } else {
+      end = pointStart(index + 1, point_size);
+      if (end >= size) break;
+    }
+    process(index, start, end + 1);
+    start = end + 1;
+  }
+}
+
+// Slide window (a SlidingEntropy or SlidingStats) over data and call
+// store(point) when it's centered on each of points [first, last), as
+// described for slidingEntropyPerPoint().
+template <typename Window, typename Store>
+void slideOverPoints(const uint8_t *data, size_t size, double point_size,
+                     size_t window, size_t first, size_t last,
+                     Window *sliding, Store store) {
+  // The window [start, end) grows to window + 1 bytes (or the whole data),
+  // then slides until its end reaches the end of data, then shrinks - so
+  // after t steps it starts at max(0, t - reach) and ends at min(t, size).
+  size_t reach = std::min(window + 1, size);
+  size_t steps = size + reach;
+  auto windowStart = [&](size_t step) {
+    return step > reach ? step - reach : 0;
+  };
+  auto windowEnd = [&](size_t step) {
+    return std::min(step, size);
+  };
+
+  // The statistics of a point are taken when the window is centered on its
+  // first byte (for the last time, if it stays there for a few steps). The
+  // first point has no such step.
+  first = std::max<size_t>(first, 1);
+  last = std::min(last, static_cast<size_t>(std::ceil(size / point_size)));
+  if (first >= last) {
+    return;
+  }
+  size_t point = first;
+  size_t next = pointStart(first, point_size);
+  size_t stop = pointStart(last, point_size);
+
+  // Find the first step centered on the first point, and fill the window.
+  size_t low = 0, high = steps;
+  while (low < high) {
+    size_t step = low + (high - low) / 2;
+    if ((windowStart(step) + windowEnd(step)) / 2 < next) {
+      low = step + 1;
+    } else {
+      high = step;
+    }
+  }
+  size_t start = windowStart(low), end = windowEnd(low);
+  for (size_t i = start; i < end; ++i) {
+    sliding->push(data[i]);
+  }
+
+  // mid only ever grows by one, so the first byte of the next point can be
+  // found in advance instead of dividing at every step.
+  while (start < size) {
+    size_t mid = (start + end) / 2;
+    if (mid >= stop) {
+      break;
+    }
+    if (mid > next) {
+      next = pointStart(++point, point_size);
+    }
+    if (mid == next) {
+      store(point);
+    }
+
+    if (end > window || end >= size) {
+      sliding->pop(data[start++]);
+    }
+    if (end < size) {
+      sliding->push(data[end++]);
+    }
+  }
+}
+
+int64_t slidingDelta(uint64_t n) {
+  return std::llround((NLogNTable::compute(n + 1) - NLogNTable::compute(n)) *
+                      k_sliding_scale);
+}
+
+}  // namespace
+
+/*****************************************************************************/
+/* NLogNTable */
+/*****************************************************************************/
+
+const size_t NLogNTable::MAX_SIZE;
+
+NLogNTable::NLogNTable(size_t size) : table_(std::min(size, MAX_SIZE)) {
+  for (size_t n = 0; n < table_.size(); ++n) {
+    table_[n] = compute(n);
+  }
+}
+
+double NLogNTable::compute(uint64_t n) {
+  return n == 0 ? 0.0 : n * std::log2(static_cast<double>(n));
+}
+
+/*****************************************************************************/
+/* Histograms */
+/*****************************************************************************/
+
+void countBytes(const uint8_t *data, size_t size, uint64_t *counts) {
+  uint32_t banks[4][256];
+  while (size > 0) {
+    size_t chunk = std::min(size, k_count_chunk_size);
+    memset(banks, 0, sizeof(banks));
+    size_t i = 0;
+    for (; i + 4 <= chunk; i += 4) {
+      banks[0][data[i]] += 1;
+      banks[1][data[i + 1]] += 1;
+      banks[2][data[i + 2]] += 1;
+      banks[3][data[i + 3]] += 1;
+    }
+    for (; i < chunk; ++i) {
+      banks[0][data[i]] += 1;
+    }
+    for (int value = 0; value < 256; ++value) {
+      counts[value] += uint64_t(banks[0][value]) + banks[1][value] +
+                       banks[2][value] + banks[3][value];
+    }
+    data += chunk;
+    size -= chunk;
+  }
+}
+
+double entropy(const uint64_t *counts, uint64_t total,
+               const NLogNTable &table) {
+  if (total == 0) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for (int value = 0; value < 256; ++value) {
+    sum += table(counts[value]);
+  }
+  return std::log2(static_cast<double>(total)) - sum / total;
+}
+
+ByteStats byteStats(const uint64_t *counts, uint64_t total,
+                    const NLogNTable &table) {
+  uint64_t sum = 0;
+  double nlogn = 0.0, squares = 0.0;
+  for (int value = 0; value < 256; ++value) {
+    sum += value * counts[value];
+    nlogn += table(counts[value]);
+    squares += static_cast<double>(counts[value]) * counts[value];
+  }
+  uint64_t printable = counts['\t'] + counts['\n'] + counts['\r'];
+  for (int value = 0x20; value < 0x7f; ++value) {
+    printable += counts[value];
+  }
+  double entropy = (total == 0) ? 0.0 : histogramEntropy(total, nlogn);
+  return finishStats(total, sum, printable, counts[0], entropy, squares);
+}
+
+/*****************************************************************************/
+/* SlidingEntropy */
+/*****************************************************************************/
+
+SlidingEntropy::SlidingEntropy(size_t max_window) :
+    deltas_(std::min(max_window + 1, NLogNTable::MAX_SIZE)), size_(0),
+    sum_(0) {
+  for (size_t n = 0; n < deltas_.size(); ++n) {
+    deltas_[n] = slidingDelta(n);
+  }
+  memset(counts_, 0, sizeof(counts_));
+}
+
+void SlidingEntropy::push(uint8_t value) {
+  sum_ += delta(counts_[value]++);
+  size_ += 1;
+}
+
+void SlidingEntropy::pop(uint8_t value) {
+  sum_ -= delta(--counts_[value]);
+  size_ -= 1;
+}
+
+int64_t SlidingEntropy::delta(uint64_t n) const {
+  return n < deltas_.size() ? deltas_[n] : slidingDelta(n);
+}
+
+size_t SlidingEntropy::size() const {
+  return size_;
+}
+
+uint64_t SlidingEntropy::count(uint8_t value) const {
+  return counts_[value];
+}
+
+double SlidingEntropy::entropy() const {
+  if (size_ == 0) {
+    return 0.0;
+  }
+  // Rounding of the fixed point sum can make it slightly negative.
+  return std::max(0.0, std::log2(static_cast<double>(size_)) -
+                       sum_ / k_sliding_scale / size_);
+}
+
+/*****************************************************************************/
+/* SlidingStats */
+/*****************************************************************************/
+
+SlidingStats::SlidingStats(size_t max_window) :
+    entropy_(max_window), printable_(0), zeros_(0), squares_(0) {}
+
+void SlidingStats::push(uint8_t value) {
+  squares_ += 2 * entropy_.count(value) + 1;
+  entropy_.push(value);
+  printable_ += k_printable_table.printable[value];
+  zeros_ += value == 0;
+}
+
+void SlidingStats::pop(uint8_t value) {
+  entropy_.pop(value);
+  squares_ -= 2 * entropy_.count(value) + 1;
+  printable_ -= k_printable_table.printable[value];
+  zeros_ -= value == 0;
+}
+
+size_t SlidingStats::size() const {
+  return entropy_.size();
+}
+
+ByteStats SlidingStats::stats() const {
+  return finishStats(size(), 0, printable_, zeros_, entropy_.entropy(),
+                     static_cast<double>(squares_));
+}
+
+/*****************************************************************************/
+/* Entropy per point */
+/*****************************************************************************/
+
+void entropyPerPoint(const uint8_t *data, size_t size, double point_size,
+                     size_t points, float *out, size_t first, size_t last) {
+  NLogNTable table(static_cast<size_t>(point_size) + 2);
+  uint64_t counts[256];
+  memset(counts, 0, sizeof(counts));
+  forEachPoint(size, point_size, points, first, last,
+               [&](size_t index, size_t begin, size_t end) {
+    out[index] = static_cast<float>(
+        pointEntropy(data + begin, end - begin, counts, table));
+  });
+}
+
+void averagePerPoint(const uint8_t *data, size_t size, double point_size,
+                     size_t points, float *out, size_t first, size_t last) {
+  forEachPoint(size, point_size, points, first, last,
+               [&](size_t index, size_t begin, size_t end) {
+    out[index] = pointAverage(data + begin, end - begin);
+  });
+}
+
+void slidingEntropyPerPoint(const uint8_t *data, size_t size,
+                            double point_size, size_t window, float *out,
+                            size_t first, size_t last) {
+  SlidingEntropy entropy(window + 1);
+  slideOverPoints(data, size, point_size, window, first, last, &entropy,
+                  [&](size_t point) {
+    out[point] = static_cast<float>(entropy.entropy());
+  });
+}
+
+void statsPerPoint(const uint8_t *data, size_t size, double point_size,
+                   size_t points, ByteStats *out, size_t first,
+                   size_t last) {
+  NLogNTable table(static_cast<size_t>(point_size) + 2);
+  uint64_t counts[256];
+  memset(counts, 0, sizeof(counts));
+  forEachPoint(size, point_size, points, first, last,
+               [&](size_t index, size_t begin, size_t end) {
+    out[index] = pointStats(data + begin, end - begin, counts, table);
+  });
+}
+
+void slidingStatsPerPoint(const uint8_t *data, size_t size,
+                          double point_size, size_t points, size_t window,
+                          ByteStats *out, size_t first, size_t last) {
+  SlidingStats sliding(window + 1);
+  slideOverPoints(data, size, point_size, window, first, last, &sliding,
+                  [&](size_t point) {
+    out[point] = sliding.stats();
+  });
+  // Averages of small points are cheap enough for a separate sweep.
+  forEachPoint(size, point_size, points, first, last,
+               [&](size_t index, size_t begin, size_t end) {
+    out[index].average = pointAverage(data + begin, end - begin);
+  });
+}
+
+}  // namespace util
+}  // namespace veles
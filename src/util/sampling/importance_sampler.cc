@@ -0,0 +1,166 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include "util/sampling/importance_sampler.h"
+
+
+namespace veles {
+namespace util {
+
+const size_t ImportanceSampler::PROBES;
+const size_t ImportanceSampler::PROBE_SIZE;
+constexpr double ImportanceSampler::MIN_WEIGHT;
+
+ImportanceSampler::ImportanceSampler(const data::PieceTable &data) :
+    ISampler(data), window_size_(0) {}
+
+ImportanceSampler::~ImportanceSampler() {}
+
+ImportanceSampler::ImportanceSampler(const ImportanceSampler& other) :
+    ISampler(other), window_size_(0) {}
+
+ImportanceSampler* ImportanceSampler::clone() {
+  return new ImportanceSampler(*this);
+}
+
+size_t ImportanceSampler::getRealSampleSize() {
+  if (!isInitialised()) {
+    return 0;
+  }
+  return window_size_ * windows_.size();
+}
+
+void ImportanceSampler::initialiseSample(size_t size) {
+  buffer_.reset();
+  windows_.clear();
+
+  // Same window size as UniformSampler.
+  window_size_ = std::max(size_t(1), (size_t)floor(sqrt(size)));
+  size_t windows_count = size / window_size_;
+
+  // The input is divided into slots (possible window positions), grouped
+  // into at most MAX_BLOCKS blocks of slots_per_block slots each.
+  size_t slots = getDataSize() / window_size_;
+  size_t slots_per_block = (slots + MAX_BLOCKS - 1) / MAX_BLOCKS;
+  size_t blocks = (slots + slots_per_block - 1) / slots_per_block;
+
+  std::vector<double> weights(blocks);
+  double total_weight = 0;
+  for (size_t i = 0; i < blocks; ++i) {
+    if (isCancelled()) return;
+    size_t block_slots = std::min(slots_per_block, slots - i * slots_per_block);
+    weights[i] = MIN_WEIGHT + estimateEntropy(
+        i * slots_per_block * window_size_, block_slots * window_size_);
+    total_weight += weights[i];
+  }
+
+  // Systematic sampling: window k goes to the block containing the
+  // (k + u) * total_weight / windows_count point of the cumulative weight.
+  // A block can't get more windows than it has slots, so the real sample
+  // may end up a bit smaller than requested.
+  std::default_random_engine generator(getSeed());
+  std::uniform_real_distribution<double> distribution(0, 1);
+  double step = total_weight / windows_count;
+  double next = distribution(generator) * step;
+  double cumulative = 0;
+  windows_.reserve(windows_count);
+  for (size_t i = 0; i < blocks; ++i) {
+    size_t block_slots = std::min(slots_per_block, slots - i * slots_per_block);
+    cumulative += weights[i];
+    size_t count = 0;
+    while (next < cumulative) {
+      ++count;
+      next += step;
+    }
+    count = std::min(count, block_slots);
+    // Spread the windows evenly over the block, with a random phase.
+    double phase = distribution(generator);
+    for (size_t j = 0; j < count; ++j) {
+      size_t slot = size_t((j + phase) * block_slots / count);
+      windows_.push_back((i * slots_per_block + slot) * window_size_);
+    }
+  }
+}
+
+char ImportanceSampler::getSampleByte(size_t index) {
+  if (buffer_ != nullptr) {
+    return buffer_.get()[index];
+  }
+  return getDataByte(getFileOffsetImpl(index));
+}
+
+const char* ImportanceSampler::getData() {
+  if (buffer_ == nullptr) {
+    char *tmp_buffer = new char[getRealSampleSize()];
+    for (size_t i = 0; i < windows_.size(); ++i) {
+      if (isCancelled()) break;
+      readData(windows_[i], window_size_, tmp_buffer + i * window_size_);
+    }
+    buffer_ = std::shared_ptr<const char>(tmp_buffer,
+                                          std::default_delete<char[]>());
+  }
+  return buffer_.get();
+}
+
+size_t ImportanceSampler::getFileOffsetImpl(size_t index) {
+  return windows_[index / window_size_] + index % window_size_;
+}
+
+size_t ImportanceSampler::getSampleOffsetImpl(size_t address) {
+  // The last window starting at or before address.
+  auto window = std::upper_bound(windows_.begin(), windows_.end(), address);
+  if (window == windows_.begin()) {
+    return 0;
+  }
+  --window;
+  size_t base_index = static_cast<size_t>(
+    std::distance(windows_.begin(), window) * window_size_);
+  return base_index + std::min(window_size_ - 1, address - *window);
+}
+
+void ImportanceSampler::resampleImpl() {
+}
+
+double ImportanceSampler::estimateEntropy(size_t start, size_t size) {
+  size_t probe_size = std::min(size, PROBE_SIZE);
+  size_t probes = std::min(PROBES, size / probe_size);
+  size_t stride = (size - probe_size) / std::max(probes - 1, size_t(1));
+  unsigned counts[256] = {0};
+  char probe[PROBE_SIZE];
+  for (size_t i = 0; i < probes; ++i) {
+    readData(start + i * stride, probe_size, probe);
+    for (size_t j = 0; j < probe_size; ++j) {
+      ++counts[static_cast<uint8_t>(probe[j])];
+    }
+  }
+  double total = double(probes * probe_size);
+  double entropy = 0;
+  for (unsigned count : counts) {
+    if (count != 0) {
+      double p = count / total;
+      entropy -= p * log2(p);
+    }
+  }
+  return entropy;
+}
+
+}  // namespace util
+}  // namespace veles
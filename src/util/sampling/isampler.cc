@@ -16,28 +16,69 @@
  */
 #include "assert.h"
 
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+
 #include "util/sampling/isampler.h"
 
 
 namespace veles {
 namespace util {
 
+static uint64_t nanosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+// Reduces an element to its 8 most significant bits, or scales it up if
+// it's narrower.
+static char normalizeElement(uint64_t value, unsigned width) {
+  return static_cast<char>(width >= 8 ? value >> (width - 8)
+                                      : value << (8 - width));
+}
+
 /*****************************************************************************/
 /* Public methods */
 /*****************************************************************************/
 
-ISampler::ISampler(const QByteArray &data) :
-    data_(data), start_(0),
-    sample_size_(0), resample_trigger_(0), initialised_(false) {
-  end_ = (data_.size() > 0) ? (data_.size() - 1) : 0;
+ISampler::ISampler(const data::PieceTable &data) :
+    data_(data), format_{data::RepackEndian::LITTLE, 8, 0, 0},
+    repack_(false), size_(data.size()), start_(0),
+    sample_size_(0), resample_trigger_(0), pass_(SIZE_MAX),
+    seed_(std::default_random_engine::default_seed),
+    initialised_(false),
+    cancelled_(nullptr), stats_() {
+  assert(data_.width() <= 64);
+  end_ = (size_ > 0) ? (size_ - 1) : 0;
+}
+
+void ISampler::setElementFormat(const data::RepackFormat &format) {
+  assert(format.width <= 64);
+  format_ = format;
+  repack_ = true;
+  size_ = data::repackableSize(data_.width(), format_, data_.size());
+  normalized_.clear();
+  start_ = 0;
+  end_ = (size_ > 0) ? (size_ - 1) : 0;
+  initialised_ = false;
+}
+
+void ISampler::setData(const data::PieceTable &data) {
+  assert(data.size() == data_.size() && data.width() == data_.width());
+  data_ = data;
+  normalized_.clear();
+  setDataImpl();
 }
 
 void ISampler::setRange(size_t start, size_t end) {
   assert(!empty());
-  assert(end < static_cast<size_t>(data_.size()));
+  assert(end < size_);
+  normalized_.clear();
   start_ = start;
   end_ = end;
-  if (start - end < resample_trigger_) {
+  if (end - start < resample_trigger_) {
     resample();
   }
   initialised_ = false;
@@ -57,6 +98,25 @@ void ISampler::setResampleTrigger(size_t sample_size) {
   resample_trigger_ = sample_size;
 }
 
+size_t ISampler::getPassesCount() {
+  if (!samplingRequired()) return 1;
+  return getPassesCountImpl(getRequestedSampleSize());
+}
+
+void ISampler::setPass(size_t pass) {
+  pass_ = pass;
+  initialised_ = false;
+}
+
+void ISampler::setSeed(uint64_t seed) {
+  seed_ = seed;
+  initialised_ = false;
+}
+
+uint64_t ISampler::getSeed() {
+  return seed_;
+}
+
 void ISampler::resample() {
   if (samplingRequired()) resampleImpl();
 }
@@ -127,14 +187,31 @@ const char* ISampler::data() {
   if (!initialised_) {
     init();
   }
-  if (!samplingRequired()) {
-    return getRawData();
-  }
-  return getData();
+  auto start = std::chrono::steady_clock::now();
+  const char *res = samplingRequired() ? getData() : getRawData();
+  ++stats_.data_calls;
+  stats_.data_ns += nanosecondsSince(start);
+  return res;
 }
 
 bool ISampler::empty() {
-  return data_.isEmpty();
+  return size_ == 0;
+}
+
+const SamplerStats& ISampler::getStats() {
+  return stats_;
+}
+
+void ISampler::resetStats() {
+  stats_ = SamplerStats();
+}
+
+void ISampler::setCache(std::shared_ptr<SampleCache> cache) {
+  cache_ = cache;
+}
+
+void ISampler::setCancellationFlag(const std::atomic<bool> *flag) {
+  cancelled_ = flag;
 }
 
 /*****************************************************************************/
@@ -142,17 +219,23 @@ bool ISampler::empty() {
 /*****************************************************************************/
 
 ISampler::ISampler(const ISampler& other) : data_(other.data_),
+                   format_(other.format_), repack_(other.repack_),
+                   size_(other.size_),
                    start_(other.start_), end_(other.end_),
                    sample_size_(other.sample_size_),
                    resample_trigger_(other.resample_trigger_),
-                   initialised_(false) {}
+                   pass_(other.pass_), seed_(other.seed_),
+                   initialised_(false), cancelled_(nullptr),
+                   cache_(other.cache_), stats_() {}
 
 size_t ISampler::getDataSize() {
-  return std::min((size_t)data_.size(), end_ - start_);
+  return std::min(size_, end_ - start_);
 }
 
 char ISampler::getDataByte(size_t index) {
-  return data_[static_cast<int>(start_ + index)];
+  char res;
+  readData(index, 1, &res);
+  return res;
 }
 
 void ISampler::reinitialisationRequired() {
@@ -163,21 +246,133 @@ bool ISampler::isInitialised() {
   return initialised_;
 }
 
+size_t ISampler::getPass() {
+  return pass_;
+}
+
+bool ISampler::isCancelled() {
+  return cancelled_ != nullptr && *cancelled_;
+}
+
 const char* ISampler::getRawData() {
-  return data_.data() + start_;
+  if (isByteInput()) {
+    // A range within a single piece can be used in place - the piece is
+    // kept alive by data_.
+    const auto pieces = data_.pieces(start_, start_ + getDataSize());
+    if (pieces.size() == 1) {
+      return reinterpret_cast<const char *>(pieces[0].rawData());
+    }
+  }
+  if (normalized_.empty()) {
+    normalized_.resize(getDataSize());
+    readData(0, normalized_.size(), normalized_.data());
+  }
+  return normalized_.data();
+}
+
+void ISampler::readData(size_t index, size_t count, char *out) {
+  // Only the requested range is taken from data_ - it's shared with the
+  // piece it lies in, and only copied if it spans several pieces.
+  size_t start = start_ + index;
+  if (isByteInput()) {
+    const data::BinData bytes = data_.data(start, start + count);
+    memcpy(out, bytes.rawData(), count);
+    stats_.bytes_read += count;
+    return;
+  }
+  if (!repack_) {
+    const data::BinData input = data_.data(start, start + count);
+    data::ElementReader elements = input.elementReader();
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = normalizeElement(elements[i], data_.width());
+    }
+    stats_.bytes_read += count * ((data_.width() + 7) / 8);
+    return;
+  }
+  // Repack just the requested elements, from the start of the repacking
+  // unit containing the first one, in batches - so that normalizing a long
+  // range (see getRawData()) doesn't repack all of it at once.
+  unsigned unit = data::repackUnit(data_.width(), format_);
+  size_t per_unit = unit / format_.paddedWidth();
+  size_t skip = start % per_unit;
+  data::RepackCursor cursor(data_, format_,
+                            start / per_unit * (unit / data_.width()),
+                            skip + count);
+  while (!cursor.atEnd()) {
+    size_t pos = cursor.pos();
+    data::BinData batch = cursor.next();
+    data::ElementReader elements = batch.elementReader();
+    for (size_t i = pos < skip ? skip - pos : 0; i < batch.size(); ++i) {
+      out[pos + i - skip] = normalizeElement(elements[i], format_.width);
+    }
+  }
+  stats_.bytes_read += data::repackSize(data_.width(), format_, skip + count) *
+                       ((data_.width() + 7) / 8);
+}
+
+SampleCache::Key ISampler::getCacheKey() {
+  SampleCache::Key key;
+  key.data = data_.version();
+  key.data_size = data_.size();
+  key.repack = repack_;
+  key.endian = repack_ ? format_.endian : data::RepackEndian::LITTLE;
+  key.width = repack_ ? format_.width : 0;
+  key.high_pad = repack_ ? format_.highPad : 0;
+  key.low_pad = repack_ ? format_.lowPad : 0;
+  key.start = start_;
+  key.end = end_;
+  key.sample_size = getRequestedSampleSize();
+  key.window_size = 0;
+  key.pass = pass_;
+  key.seed = seed_;
+  return key;
+}
+
+std::shared_ptr<const SampleCache::Sample> ISampler::findCachedSample(
+    const SampleCache::Key &key) {
+  if (cache_ == nullptr) return nullptr;
+  auto sample = cache_->find(key);
+  if (sample != nullptr) {
+    ++stats_.cache_hits;
+  } else {
+    ++stats_.cache_misses;
+  }
+  return sample;
+}
+
+void ISampler::cacheSample(const SampleCache::Key &key,
+                           std::shared_ptr<const SampleCache::Sample> sample) {
+  if (cache_ != nullptr) {
+    cache_->insert(key, data_, sample);
+  }
 }
 
 /*****************************************************************************/
 /* Private methods */
 /*****************************************************************************/
 
+size_t ISampler::getPassesCountImpl(size_t size) {
+  return 1;
+}
+
+void ISampler::setDataImpl() {
+  initialised_ = false;
+}
+
 void ISampler::init() {
   if (samplingRequired()) {
+    auto start = std::chrono::steady_clock::now();
     initialiseSample(getRequestedSampleSize());
+    ++stats_.initialisations;
+    stats_.initialise_ns += nanosecondsSince(start);
   }
   initialised_ = true;
 }
 
+bool ISampler::isByteInput() {
+  return !repack_ && data_.width() == 8;
+}
+
 size_t ISampler::samplingRequired() {
   return ((!empty()) && getRequestedSampleSize() < getDataSize());
 }
@@ -0,0 +1,102 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <tuple>
+
+#include "util/sampling/sample_cache.h"
+
+namespace veles {
+namespace util {
+
+bool SampleCache::Key::operator<(const Key &other) const {
+  return std::tie(data, data_size, repack, endian, width, high_pad, low_pad,
+                  start, end, sample_size, window_size, pass, seed) <
+      std::tie(other.data, other.data_size, other.repack, other.endian,
+               other.width, other.high_pad, other.low_pad, other.start,
+               other.end, other.sample_size, other.window_size, other.pass,
+               other.seed);
+}
+
+/*****************************************************************************/
+/* Public methods */
+/*****************************************************************************/
+
+SampleCache::SampleCache(size_t max_size) : size_(0), max_size_(max_size) {}
+
+std::shared_ptr<const SampleCache::Sample> SampleCache::find(
+    const Key &key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->sample;
+}
+
+void SampleCache::insert(const Key &key, const data::PieceTable &input,
+                         std::shared_ptr<const Sample> sample) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = sampleSize(*sample);
+  if (size > max_size_ || index_.count(key) != 0) {
+    return;
+  }
+  evict(max_size_ - size);
+  entries_.push_front(Entry{key, input, sample});
+  index_[key] = entries_.begin();
+  size_ += size;
+}
+
+void SampleCache::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  evict(0);
+}
+
+void SampleCache::setMaxSize(size_t max_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_size_ = max_size;
+  evict(max_size_);
+}
+
+size_t SampleCache::maxSize() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return max_size_;
+}
+
+size_t SampleCache::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return size_;
+}
+
+/*****************************************************************************/
+/* Private methods */
+/*****************************************************************************/
+
+size_t SampleCache::sampleSize(const Sample &sample) {
+  return sample.size + sample.windows.size() * sizeof(size_t);
+}
+
+void SampleCache::evict(size_t max_size) {
+  while (size_ > max_size) {
+    const Entry &entry = entries_.back();
+    size_ -= sampleSize(*entry.sample);
+    index_.erase(entry.key);
+    entries_.pop_back();
+  }
+}
+
+}  // namespace util
+}  // namespace veles
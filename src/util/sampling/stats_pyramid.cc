@@ -0,0 +1,252 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "util/sampling/stats_pyramid.h"
+
+namespace veles {
+namespace util {
+
+const size_t StatsPyramid::MIN_BLOCK_SIZE;
+const size_t StatsPyramid::MAX_BLOCKS;
+
+double StatsPyramid::Stats::average() const {
+  return count == 0 ? 0.0 : static_cast<double>(sum) / count;
+}
+
+double StatsPyramid::Stats::entropy() const {
+  double entropy = 0.0;
+  for (int i = 0; i < 256; ++i) {
+    if (histogram[i] > 0) {
+      double p = static_cast<double>(histogram[i]) / count;
+      entropy -= p * std::log2(p);
+    }
+  }
+  return entropy;
+}
+
+/*****************************************************************************/
+/* Public methods */
+/*****************************************************************************/
+
+StatsPyramid::StatsPyramid(const data::PieceTable &data, size_t block_size) :
+    data_(data), block_size_(block_size), ready_(false) {
+  assert(data_.width() <= 64);
+  if (block_size_ == 0) {
+    block_size_ = MIN_BLOCK_SIZE;
+    while ((data_.size() + block_size_ - 1) / block_size_ > MAX_BLOCKS) {
+      block_size_ *= 2;
+    }
+  }
+}
+
+bool StatsPyramid::build(const std::atomic<bool> *cancelled) {
+  size_t blocks = (data_.size() + block_size_ - 1) / block_size_;
+  histograms_.assign(1, std::vector<uint32_t>(blocks * 256));
+  sums_.assign(1, std::vector<uint64_t>(blocks));
+  for (size_t block = 0; block < blocks; ++block) {
+    if (cancelled != nullptr && *cancelled) {
+      return false;
+    }
+    computeBlock(block);
+  }
+
+  uint64_t span = block_size_;
+  while (sums_.back().size() > 1 && span * 2 <= UINT32_MAX) {
+    size_t nodes = (sums_.back().size() + 1) / 2;
+    histograms_.emplace_back(nodes * 256);
+    sums_.emplace_back(nodes);
+    for (size_t node = 0; node < nodes; ++node) {
+      mergeNode(sums_.size() - 1, node);
+    }
+    span *= 2;
+  }
+  ready_ = true;
+  return true;
+}
+
+bool StatsPyramid::ready() const {
+  return ready_;
+}
+
+bool StatsPyramid::update(const data::PieceTable &data, size_t start,
+                          size_t end) {
+  if (!ready_ || data.size() != data_.size() ||
+      data.width() != data_.width()) {
+    return false;
+  }
+  data_ = data;
+  end = std::min(end, data_.size());
+  if (start >= end) {
+    return true;
+  }
+  // Nodes [first, last) of each level cover the edit.
+  size_t first = start / block_size_;
+  size_t last = (end - 1) / block_size_ + 1;
+  for (size_t block = first; block < last; ++block) {
+    computeBlock(block);
+  }
+  for (size_t level = 1; level < sums_.size(); ++level) {
+    first /= 2;
+    last = (last + 1) / 2;
+    for (size_t node = first; node < last; ++node) {
+      mergeNode(level, node);
+    }
+  }
+  return true;
+}
+
+StatsPyramid::Stats StatsPyramid::query(size_t start, size_t end,
+                                        bool with_histogram) const {
+  assert(ready_);
+  assert(start <= end && end <= data_.size());
+  Stats stats = Stats();
+  // Blocks [first, last) are covered entirely.
+  size_t first = (start + block_size_ - 1) / block_size_;
+  size_t last = end == data_.size() ? sums_[0].size() : end / block_size_;
+  if (first >= last) {
+    countElements(start, end, &stats, with_histogram);
+    return stats;
+  }
+  countElements(start, first * block_size_, &stats, with_histogram);
+  if (last * block_size_ < end) {
+    countElements(last * block_size_, end, &stats, with_histogram);
+  }
+
+  size_t level = 0;
+  while (first < last) {
+    if (level + 1 == sums_.size()) {
+      for (size_t node = first; node < last; ++node) {
+        addNode(level, node, &stats, with_histogram);
+      }
+      break;
+    }
+    if (first % 2 == 1) {
+      addNode(level, first++, &stats, with_histogram);
+    }
+    if (last % 2 == 1) {
+      addNode(level, --last, &stats, with_histogram);
+    }
+    first /= 2;
+    last /= 2;
+    ++level;
+  }
+  return stats;
+}
+
+size_t StatsPyramid::alignOffset(size_t offset) const {
+  size_t aligned = (offset + block_size_ / 2) / block_size_ * block_size_;
+  return std::min(aligned, data_.size());
+}
+
+size_t StatsPyramid::getBlockSize() const {
+  return block_size_;
+}
+
+size_t StatsPyramid::size() const {
+  return data_.size();
+}
+
+/*****************************************************************************/
+/* Private methods */
+/*****************************************************************************/
+
+void StatsPyramid::computeBlock(size_t block) {
+  Stats stats = Stats();
+  countElements(block * block_size_,
+                std::min((block + 1) * block_size_, data_.size()),
+                &stats, true);
+  std::copy(stats.histogram, stats.histogram + 256,
+            histograms_[0].begin() + block * 256);
+  sums_[0][block] = stats.sum;
+}
+
+void StatsPyramid::mergeNode(size_t level, size_t node) {
+  const std::vector<uint32_t> &prev_histograms = histograms_[level - 1];
+  const std::vector<uint64_t> &prev_sums = sums_[level - 1];
+  uint32_t *histogram = &histograms_[level][node * 256];
+  uint64_t sum = 0;
+  std::fill(histogram, histogram + 256, 0);
+  for (size_t child = 2 * node;
+       child < std::min(2 * node + 2, prev_sums.size()); ++child) {
+    for (size_t value = 0; value < 256; ++value) {
+      histogram[value] += prev_histograms[child * 256 + value];
+    }
+    sum += prev_sums[child];
+  }
+  sums_[level][node] = sum;
+}
+
+void StatsPyramid::countElements(size_t start, size_t end, Stats *stats,
+                                 bool with_histogram) const {
+  if (start >= end) {
+    return;
+  }
+  stats->count += end - start;
+  uint64_t counts[256];
+  memset(counts, 0, sizeof(counts));
+  unsigned width = data_.width();
+  for (const auto &piece : data_.pieces(start, end)) {
+    if (width == 8) {
+      const uint8_t *bytes = piece.rawData();
+      if (!with_histogram) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < piece.size(); ++i) {
+          sum += bytes[i];
+        }
+        stats->sum += sum;
+        continue;
+      }
+      for (size_t i = 0; i < piece.size(); ++i) {
+        counts[bytes[i]] += 1;
+      }
+    } else {
+      data::ElementReader elements = piece.elementReader();
+      for (size_t i = 0; i < piece.size(); ++i) {
+        uint64_t value = elements[i];
+        counts[static_cast<uint8_t>(width >= 8 ? value >> (width - 8)
+                                               : value << (8 - width))] += 1;
+      }
+    }
+  }
+  for (size_t value = 0; value < 256; ++value) {
+    stats->sum += value * counts[value];
+    if (with_histogram) {
+      stats->histogram[value] += counts[value];
+    }
+  }
+}
+
+void StatsPyramid::addNode(size_t level, size_t index, Stats *stats,
+                           bool with_histogram) const {
+  uint64_t span = uint64_t(block_size_) << level;
+  stats->count += std::min((index + 1) * span, uint64_t(data_.size())) -
+                  index * span;
+  stats->sum += sums_[level][index];
+  if (with_histogram) {
+    const uint32_t *histogram = &histograms_[level][index * 256];
+    for (size_t value = 0; value < 256; ++value) {
+      stats->histogram[value] += histogram[value];
+    }
+  }
+}
+
+}  // namespace util
+}  // namespace veles
@@ -0,0 +1,144 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <random>
+
+#include "util/sampling/streaming_sampler.h"
+
+
+namespace veles {
+namespace util {
+
+StreamingSampler::StreamingSampler(const data::PieceTable &data) :
+    ISampler(data), window_size_(0) {}
+
+StreamingSampler::~StreamingSampler() {}
+
+StreamingSampler::StreamingSampler(const StreamingSampler& other) :
+    ISampler(other), window_size_(0) {}
+
+StreamingSampler* StreamingSampler::clone() {
+  return new StreamingSampler(*this);
+}
+
+size_t StreamingSampler::getRealSampleSize() {
+  if (!isInitialised()) {
+    return 0;
+  }
+  return window_size_ * windows_.size();
+}
+
+void StreamingSampler::initialiseSample(size_t size) {
+  buffer_.reset();
+  windows_.clear();
+
+  // Same window size as UniformSampler.
+  window_size_ = std::max(size_t(1), (size_t)floor(sqrt(size)));
+  size_t slots = getDataSize() / window_size_;
+  size_t count = std::min(size / window_size_, slots);
+  if (count == 0) return;
+
+  // Algorithm L: the first count slots fill the reservoir, then the gaps
+  // between the slots which replace a random reservoir entry are drawn from
+  // a geometric distribution, so the skipped slots are never read.
+  std::default_random_engine generator(getSeed());
+  std::uniform_real_distribution<double> distribution(0, 1);
+  std::uniform_int_distribution<size_t> random_entry(0, count - 1);
+  // Uniform on (0, 1), so that the logarithms below stay finite.
+  auto random = [&]() {
+    double u;
+    do {
+      u = distribution(generator);
+    } while (u == 0);
+    return u;
+  };
+  auto skip = [&](double w) {
+    double gap = floor(log(random()) / log(1 - w)) + 1;
+    return gap < slots ? size_t(gap) : slots;
+  };
+
+  std::vector<size_t> reservoir(count);
+  std::vector<char> reservoir_data(count * window_size_);
+  double w = exp(log(random()) / count);
+  size_t next_slot = count - 1 + skip(w);
+  size_t slots_per_block = std::max(size_t(1), BLOCK_SIZE / window_size_);
+  for (size_t block = 0; block < slots; block += slots_per_block) {
+    if (isCancelled()) break;
+    size_t block_end = std::min(block + slots_per_block, slots);
+    for (size_t slot = block; slot < std::min(count, block_end); ++slot) {
+      reservoir[slot] = slot * window_size_;
+      readData(reservoir[slot], window_size_,
+               reservoir_data.data() + slot * window_size_);
+    }
+    while (next_slot < block_end) {
+      size_t entry = random_entry(generator);
+      reservoir[entry] = next_slot * window_size_;
+      readData(reservoir[entry], window_size_,
+               reservoir_data.data() + entry * window_size_);
+      w *= exp(log(random()) / count);
+      next_slot += skip(w);
+    }
+  }
+
+  // Put the windows back in file order.
+  std::vector<size_t> order(count);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&reservoir](size_t a, size_t b) {
+    return reservoir[a] < reservoir[b];
+  });
+  windows_.resize(count);
+  char *buffer = new char[count * window_size_];
+  for (size_t i = 0; i < count; ++i) {
+    windows_[i] = reservoir[order[i]];
+    memcpy(buffer + i * window_size_,
+           reservoir_data.data() + order[i] * window_size_, window_size_);
+  }
+  buffer_ = std::shared_ptr<const char>(buffer, std::default_delete<char[]>());
+}
+
+char StreamingSampler::getSampleByte(size_t index) {
+  return buffer_.get()[index];
+}
+
+const char* StreamingSampler::getData() {
+  return buffer_.get();
+}
+
+size_t StreamingSampler::getFileOffsetImpl(size_t index) {
+  return windows_[index / window_size_] + index % window_size_;
+}
+
+size_t StreamingSampler::getSampleOffsetImpl(size_t address) {
+  // The last window starting at or before address.
+  auto window = std::upper_bound(windows_.begin(), windows_.end(), address);
+  if (window == windows_.begin()) {
+    return 0;
+  }
+  --window;
+  size_t base_index = static_cast<size_t>(
+    std::distance(windows_.begin(), window) * window_size_);
+  return base_index + std::min(window_size_ - 1, address - *window);
+}
+
+void StreamingSampler::resampleImpl() {
+}
+
+}  // namespace util
+}  // namespace veles
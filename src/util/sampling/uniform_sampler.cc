@@ -16,7 +16,9 @@
  */
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iterator>
 #include <random>
 #include <set>
@@ -27,18 +29,24 @@
 namespace veles {
 namespace util {
 
-UniformSampler::UniformSampler(const QByteArray &data) :
-    ISampler(data), window_size_(0), use_default_window_size_(true),
-    buffer_(nullptr) {}
+UniformSampler::UniformSampler(const data::PieceTable &data) :
+    ISampler(data), window_size_(0), windows_count_(0),
+    use_default_window_size_(true), progressive_(false), incremental_(false),
+    sampled_start_(0), sampled_end_(0), sampled_window_size_(0) {}
 
-UniformSampler::~UniformSampler() {
-  if (buffer_ != nullptr) {
-    delete[] buffer_;
-  }
-}
+UniformSampler::~UniformSampler() {}
 
+// The clone shares the sample (its windows and the immutable buffer), so that
+// in incremental mode it only needs to read what's missing for a new range.
 UniformSampler::UniformSampler(const UniformSampler& other) :
-    ISampler(other), window_size_(other.window_size_), buffer_(nullptr) {}
+    ISampler(other), window_size_(other.window_size_),
+    windows_count_(other.windows_count_),
+    use_default_window_size_(other.use_default_window_size_),
+    progressive_(other.progressive_), incremental_(other.incremental_),
+    sampled_start_(other.sampled_start_), sampled_end_(other.sampled_end_),
+    sampled_window_size_(other.sampled_window_size_),
+    windows_(other.windows_), buffer_(other.buffer_),
+    cache_key_(other.cache_key_) {}
 
 UniformSampler* UniformSampler::clone() {
   return new UniformSampler(*this);
@@ -47,13 +55,19 @@ UniformSampler* UniformSampler::clone() {
 void UniformSampler::setWindowSize(size_t size) {
   window_size_ = size;
   use_default_window_size_ = size == 0;
-  if (buffer_ != nullptr) {
-    delete[] buffer_;
-    buffer_ = nullptr;
-  }
+  buffer_.reset();
+  reinitialisationRequired();
+}
+
+void UniformSampler::setProgressive(bool progressive) {
+  progressive_ = progressive;
   reinitialisationRequired();
 }
 
+void UniformSampler::setIncremental(bool incremental) {
+  incremental_ = incremental;
+}
+
 size_t UniformSampler::getRealSampleSize() {
   if (!isInitialised()) {
     return 0;
@@ -62,20 +76,55 @@ size_t UniformSampler::getRealSampleSize() {
 }
 
 void UniformSampler::initialiseSample(size_t size) {
-  // default size == sqrt(sample size)
-  if (buffer_ != nullptr) {
-    delete[] buffer_;
-    buffer_ = nullptr;
+  auto previous_buffer = buffer_;
+  buffer_.reset();
+
+  window_size_ = windowSizeFor(size);
+  windows_count_ = (size_t)floor(size / window_size_);
+
+  cache_key_ = getCacheKey();
+  cache_key_.window_size = window_size_;
+  auto cached = findCachedSample(cache_key_);
+  if (cached != nullptr) {
+    windows_ = cached->windows;
+    windows_count_ = windows_.size();
+    buffer_ = cached->data;
+    setSampledRange();
+    return;
   }
 
-  if (use_default_window_size_ || window_size_ == 0) {
-    window_size_ = (size_t)floor(sqrt(size));
+  size_t passes = getPassesCountImpl(size);
+  if (incremental_ && getPass() >= passes - 1 &&
+      topUpWindows(previous_buffer)) {
+    return;
   }
-  windows_count_ = (size_t)floor(size / window_size_);
 
+  std::default_random_engine generator(getSeed());
+  windows_.clear();
+  if (!chooseWindows(&generator, 0, getDataSize(), windows_count_,
+                     &windows_)) {
+    return;
+  }
+  setSampledRange();
+
+  // Progressive sampling: pass p out of n keeps every 2^(n-1-p)-th window,
+  // so each pass is a superset of the previous one.
+  if (getPass() < passes - 1) {
+    size_t stride = size_t(1) << (passes - 1 - getPass());
+    size_t kept = 0;
+    for (size_t i = 0; i < windows_count_; i += stride) {
+      windows_[kept++] = windows_[i];
+    }
+    windows_count_ = kept;
+    windows_.resize(kept);
+  }
+}
+
+bool UniformSampler::chooseWindows(std::default_random_engine *generator,
+                                   size_t start, size_t length, size_t count,
+                                   std::vector<size_t> *windows) {
   // Algorithm:
-  // First let's mark windows_count_ as m, window_size_ as k and
-  // getDataSize() as n.
+  // First let's mark count as m, window_size_ as k and length as n.
   // 1. Take m numbers from {0, 1 ... n - m*k} with repetitions,
   //    marked as (c_i) sequence.
   // 2. Sort (c_i) sequence.
@@ -88,22 +137,110 @@ void UniformSampler::initialiseSample(size_t size) {
   //   n - m*k + (m-1)*k = n - k
   //   which is exactly what we want because the piece length is k.
   // - For each i the distance d_{i+1}-d_i >= k.
-  size_t max_index = getDataSize() - windows_count_ * window_size_;
-  std::default_random_engine generator;
+  size_t max_index = length - count * window_size_;
   std::uniform_int_distribution<size_t> distribution(0, max_index);
-  windows_.resize(windows_count_);
-  for (size_t i = 0; i < windows_count_; ++i) {
-    windows_[i] = distribution(generator);
+  size_t first = windows->size();
+  windows->resize(first + count);
+  auto chosen = windows->begin() + first;
+  for (size_t i = 0; i < count; ++i) {
+    if (i % CANCELLATION_CHECK_INTERVAL == 0 && isCancelled()) return false;
+    chosen[i] = distribution(*generator);
   }
-  std::sort(windows_.begin(), windows_.end());
-  for (size_t i = 0; i < windows_count_; ++i) {
-    windows_[i] += i*window_size_;
+  std::sort(chosen, windows->end());
+  for (size_t i = 0; i < count; ++i) {
+    chosen[i] += start + i*window_size_;
   }
+  return true;
+}
+
+bool UniformSampler::topUpWindows(
+    const std::shared_ptr<const char> &previous_buffer) {
+  // The result is only uniform if the new range lies within the sampled one.
+  size_t start = getRange().first;
+  size_t length = getDataSize();
+  if (windows_.empty() || window_size_ != sampled_window_size_ ||
+      start < sampled_start_ || start + length > sampled_end_) {
+    return false;
+  }
+
+  // Windows still inside the range (relative to its start), along with their
+  // index in the previous sample.
+  std::vector<size_t> kept, kept_index;
+  for (size_t i = 0; i < windows_.size(); ++i) {
+    size_t window = sampled_start_ + windows_[i];
+    if (window >= start && window + window_size_ <= start + length) {
+      kept.push_back(window - start);
+      kept_index.push_back(i);
+    }
+  }
+  if (kept.size() > windows_count_) {
+    std::vector<size_t> thinned, thinned_index;
+    for (size_t i = 0; i < windows_count_; ++i) {
+      size_t j = i * kept.size() / windows_count_;
+      thinned.push_back(kept[j]);
+      thinned_index.push_back(kept_index[j]);
+    }
+    kept.swap(thinned);
+    kept_index.swap(thinned_index);
+  }
+
+  // The missing windows are spread over the gaps between kept ones in
+  // proportion to their length (systematic sampling), as far as they fit.
+  std::seed_seq seed{getSeed(), getSeed() >> 32, uint64_t(start),
+                     uint64_t(start) >> 32, uint64_t(length),
+                     uint64_t(length) >> 32};
+  std::default_random_engine generator(seed);
+  std::uniform_real_distribution<double> distribution(0, 1);
+  size_t missing = windows_count_ - kept.size();
+  double step = double(length - kept.size() * window_size_) / missing;
+  double next = missing > 0 ? distribution(generator) * step : 0;
+  double cumulative = 0;
+  std::vector<size_t> windows, sources;
+  size_t gap_start = 0;
+  for (size_t i = 0; i <= kept.size(); ++i) {
+    size_t gap = (i < kept.size() ? kept[i] : length) - gap_start;
+    cumulative += gap;
+    size_t count = 0;
+    while (missing > 0 && next < cumulative) {
+      ++count;
+      next += step;
+    }
+    count = std::min(count, gap / window_size_);
+    // If cancelled, the Sampler is going to be thrown away anyway.
+    if (!chooseWindows(&generator, gap_start, gap, count, &windows)) {
+      return true;
+    }
+    sources.resize(windows.size(), SIZE_MAX);
+    if (i < kept.size()) {
+      windows.push_back(kept[i]);
+      sources.push_back(kept_index[i]);
+      gap_start = kept[i] + window_size_;
+    }
+  }
+
+  // Kept windows are copied from the previous sample, if it's there, so
+  // only the new ones need to be read from the input.
+  char *buffer = new char[windows.size() * window_size_];
+  for (size_t i = 0; i < windows.size(); ++i) {
+    if (isCancelled()) break;
+    if (sources[i] != SIZE_MAX && previous_buffer != nullptr) {
+      memcpy(buffer + i * window_size_,
+             previous_buffer.get() + sources[i] * window_size_, window_size_);
+    } else {
+      readData(windows[i], window_size_, buffer + i * window_size_);
+    }
+  }
+  windows_.swap(windows);
+  windows_count_ = windows_.size();
+  sampled_start_ = start;
+  sampled_end_ = start + length;
+  buffer_ = std::shared_ptr<const char>(buffer, std::default_delete<char[]>());
+  return true;
 }
 
 char UniformSampler::getSampleByte(size_t index) {
   if (buffer_ != nullptr) {
-    return buffer_[index];
+    return buffer_.get()[index];
   }
   size_t base_index = windows_[index / window_size_];
   return getDataByte(base_index + (index % window_size_));
@@ -112,15 +249,20 @@ char UniformSampler::getSampleByte(size_t index) {
 const char* UniformSampler::getData() {
   if (buffer_ == nullptr) {
     size_t size = getSampleSize();
-    const char *raw_data = getRawData();
     char *tmp_buffer = new char[size];
-    for (size_t i=0; i < size; ++i) {
-      size_t base_index = windows_[i / window_size_];
-      tmp_buffer[i] = raw_data[base_index + (i % window_size_)];
+    // Every window is contiguous in the input.
+    for (size_t i = 0; i < windows_count_; ++i) {
+      if (isCancelled()) break;
+      readData(windows_[i], window_size_, tmp_buffer + i * window_size_);
+    }
+    buffer_ = std::shared_ptr<const char>(tmp_buffer,
+                                          std::default_delete<char[]>());
+    if (!isCancelled()) {
+      cacheSample(cache_key_, std::make_shared<SampleCache::Sample>(
+          SampleCache::Sample{windows_, buffer_, size}));
     }
-    buffer_ = tmp_buffer;
   }
-  return buffer_;
+  return buffer_.get();
 }
 
 size_t UniformSampler::getFileOffsetImpl(size_t index) {
@@ -137,6 +279,41 @@ size_t UniformSampler::getSampleOffsetImpl(size_t address) {
 }
 
 void UniformSampler::resampleImpl() {
+  // Forget the windows, so that incremental mode can't reuse them.
+  windows_.clear();
+  reinitialisationRequired();
+}
+
+void UniformSampler::setDataImpl() {
+  // Windows are chosen regardless of the contents, so they stay (and so do
+  // offsets in the sample). Only their copy is outdated.
+  buffer_.reset();
+  cache_key_.data = getCacheKey().data;
+}
+
+void UniformSampler::setSampledRange() {
+  sampled_start_ = getRange().first;
+  sampled_end_ = sampled_start_ + getDataSize();
+  sampled_window_size_ = window_size_;
+}
+
+size_t UniformSampler::getPassesCountImpl(size_t size) {
+  size_t window_size = windowSizeFor(size);
+  if (!progressive_ || window_size == 0) return 1;
+  size_t passes = 1;
+  for (size_t count = size / window_size; count > MIN_PASS_WINDOWS;
+       count = (count + 1) / 2) {
+    ++passes;
+  }
+  return passes;
+}
+
+size_t UniformSampler::windowSizeFor(size_t size) {
+  // default size == sqrt(sample size)
+  if (use_default_window_size_ || window_size_ == 0) {
+    return (size_t)floor(sqrt(size));
+  }
+  return window_size_;
 }
 
 }  // namespace util
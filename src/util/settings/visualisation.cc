@@ -0,0 +1,53 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <random>
+
+#include <QSettings>
+#include "util/sampling/sample_cache.h"
+#include "util/settings/visualisation.h"
+
+namespace veles {
+namespace util {
+namespace settings {
+namespace visualisation {
+
+size_t sampleCacheSize() {
+  QSettings settings;
+  return settings.value("visualisation.sampleCacheSize",
+      qulonglong(SampleCache::DEFAULT_MAX_SIZE)).toULongLong();
+}
+
+void setSampleCacheSize(size_t size) {
+  QSettings settings;
+  settings.setValue("visualisation.sampleCacheSize", qulonglong(size));
+}
+
+uint64_t samplingSeed() {
+  QSettings settings;
+  return settings.value("visualisation.samplingSeed",
+      qulonglong(std::default_random_engine::default_seed)).toULongLong();
+}
+
+void setSamplingSeed(uint64_t seed) {
+  QSettings settings;
+  settings.setValue("visualisation.samplingSeed", qulonglong(seed));
+}
+
+}  // namespace visualisation
+}  // namespace settings
+}  // namespace util
+}  // namespace veles
@@ -15,9 +15,13 @@
  *
  */
 #include "visualisation/minimap.h"
+#include "util/parallel.h"
+#include "util/sampling/entropy.h"
 #include <QImage>
+#include <algorithm>
 #include <cstdlib>
 #include <cmath>
+#include <vector>
 #include <assert.h>
 
 
@@ -50,6 +54,11 @@ void VisualisationMinimap::setSampler(util::ISampler *sampler) {
   refresh();
 }
 
+void VisualisationMinimap::setStatsPyramid(
+    std::shared_ptr<util::StatsPyramid> pyramid) {
+  stats_pyramid_ = pyramid;
+}
+
 QPair<size_t, size_t> VisualisationMinimap::getSelectedRange() {
   if (empty()) return qMakePair(0, 0);
   size_t start = sampler_->getFileOffset(selection_start_);
@@ -73,11 +82,64 @@ void VisualisationMinimap::refresh(bool has_context) {
   if (!has_context) makeCurrent();
   delete lines_texture_;
   delete texture_;
+  texture_ = nullptr;
+  pixel_stats_.clear();
   initTextures();
   if (!has_context) doneCurrent();
   update();
 }
 
+void VisualisationMinimap::updateRange(size_t start, size_t end) {
+  if (!initialised_ || !gl_initialised_ || empty()) return;
+  if (exact_boundaries_.empty()) {
+    // The texture comes from the sample - the pyramid has just become
+    // ready (and the texture is about to be recomputed anyway).
+    refresh();
+    return;
+  }
+  // Small pixels take their statistics from a wider window.
+  start = (start > k_minimum_entropy_window)
+      ? start - k_minimum_entropy_window : 0;
+  end += k_minimum_entropy_window;
+  // Pixels [first, last) overlap the edit.
+  size_t pixels = exact_boundaries_.size() - 1;
+  size_t first = std::upper_bound(exact_boundaries_.begin(),
+                                  exact_boundaries_.end(), start) -
+                 exact_boundaries_.begin();
+  first = (first > 0) ? first - 1 : 0;
+  size_t last = std::lower_bound(exact_boundaries_.begin(),
+                                 exact_boundaries_.end(), end) -
+                exact_boundaries_.begin();
+  last = std::min(last, pixels);
+  if (first >= last) return;
+
+  auto range = sampler_->getRange();
+  util::parallelFor(last - first, k_exact_pixels_per_task,
+                    [&](size_t chunk_first, size_t chunk_last) {
+    calculateExactPixels(range, first + chunk_first, first + chunk_last,
+                         pixel_stats_.data() + first + chunk_first);
+  });
+
+  // Whole rows are uploaded, pixels past the end stay 0 as in initTextures().
+  size_t first_row = first / texture_cols_;
+  size_t last_row = (last - 1) / texture_cols_ + 1;
+  std::vector<float> rows((last_row - first_row) * texture_cols_);
+  for (size_t i = 0; i < rows.size(); ++i) {
+    rows[i] = channelValue(pixel_stats_[first_row * texture_cols_ + i]);
+  }
+
+  makeCurrent();
+  texture_->bind();
+  // Mipmaps aren't used (the minification filter is Nearest), so only the
+  // base level is updated.
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, static_cast<GLint>(first_row),
+                  static_cast<GLsizei>(texture_cols_),
+                  static_cast<GLsizei>(last_row - first_row), GL_RED,
+                  GL_FLOAT, rows.data());
+  doneCurrent();
+  update();
+}
+
 void VisualisationMinimap::setRange(size_t start, size_t end,
                                     bool reset_selection) {
   assert(!empty());
@@ -107,128 +169,113 @@ void VisualisationMinimap::setMinimapColor(MinimapColor color) {
 }
 
 void VisualisationMinimap::setMinimapMode(MinimapMode mode) {
+  if (mode == mode_) return;
   mode_ = mode;
-  refresh();
+  if (texture_ == nullptr || pixel_stats_.empty()) {
+    refresh();
+    return;
+  }
+  // Statistics of all modes are already there.
+  makeCurrent();
+  uploadTexture();
+  doneCurrent();
+  update();
 }
 
 /*****************************************************************************/
 /* calculate minimap texture methods */
 /*****************************************************************************/
 
-float* VisualisationMinimap::calculateAverageValueTexture(
+void VisualisationMinimap::calculateSampleStats(
               const uint8_t *sample, size_t sample_size,
-              size_t texture_size, double point_size) {
-  auto bigtab = new float[texture_size];
-  memset(bigtab, 0, texture_size * sizeof(*bigtab));
-  uint64_t point_sum = 0, point_count = 0;
-
-  size_t index = 0;
-  for (size_t i = 0; i < sample_size; ++i) {
-    point_sum += sample[i];
-    point_count += 1;
-    if (static_cast<double>(i) / point_size >= index + 1) {
-      if (index == texture_size - 1 && i < sample_size - 1) continue;
-      uint8_t result = (point_count == 0) ? 0 : point_sum / point_count;
-      bigtab[index] = static_cast<float>(result); // HAX
-      index += 1;
-      point_sum = 0;
-      point_count = 0;
-    }
-  }
-  return bigtab;
-}
-
-float* VisualisationMinimap::calculateEntropyTexture(
-              const uint8_t *sample, size_t sample_size,
-              size_t texture_size, double point_size) {
+              size_t texture_size, double point_size, util::ByteStats *out) {
   if (point_size > k_minimum_entropy_window) {
-    return calculateEntropyTexturePerPixel(sample, sample_size,
-                                           texture_size, point_size);
-  }
-  if (sample_size < 2 * k_minimum_entropy_window) {
-    return calculateEntropyTextureSingleWindow(sample, sample_size,
-                                               texture_size, point_size);
+    util::parallelFor(texture_size, pointsPerTask(point_size),
+                      [&](size_t first, size_t last) {
+      util::statsPerPoint(sample, sample_size, point_size, texture_size, out,
+                          first, last);
+    });
+  } else if (sample_size < 2 * k_minimum_entropy_window) {
+    util::statsPerPoint(sample, sample_size, point_size, texture_size, out);
+    calculateSingleWindowEntropy(sample, sample_size, texture_size,
+                                 point_size, out);
+  } else {
+    // Points are too small for statistics of their own, so they're taken
+    // from a window around each of them. Each task fills its first window
+    // from scratch, which is cheap compared to the points it computes.
+    util::parallelFor(texture_size, pointsPerTask(point_size),
+                      [&](size_t first, size_t last) {
+      util::slidingStatsPerPoint(sample, sample_size, point_size,
+                                 texture_size, k_minimum_entropy_window, out,
+                                 first, last);
+    });
   }
-  return calculateEntropyTextureSlidingWindow(sample, sample_size,
-                                              texture_size, point_size);
 }
 
-float* VisualisationMinimap::calculateEntropyTexturePerPixel(
-              const uint8_t *sample, size_t sample_size,
-              size_t texture_size, double point_size) {
-  auto bigtab = new float[texture_size];
-  memset(bigtab, 0, texture_size * sizeof(*bigtab));
-
-  auto counts = new uint64_t[256]; // assume 8-bit bytes
-  memset(counts, 0, 256 * sizeof(*counts));
-
-  size_t index = 0, point_count = 0;
+void VisualisationMinimap::calculateExactStats(size_t texture_size) {
+  // Pixels cover the same parts of the file as with the sample, so that the
+  // texture matches selection lines. If they span many pyramid blocks, their
+  // boundaries are aligned to blocks, so that no data has to be read.
+  auto range = sampler_->getRange();
+  bool align = (range.second - range.first) / texture_size >=
+               stats_pyramid_->getBlockSize();
+  auto boundary = [&](size_t index) {
+    size_t offset = (index >= sample_size_) ? range.second
+                                            : sampler_->getFileOffset(index);
+    offset = std::min(offset, stats_pyramid_->size());
+    return align ? stats_pyramid_->alignOffset(offset) : offset;
+  };
 
-  for (size_t i = 0; i < sample_size; ++i) {
-    counts[sample[i]] += 1;
-    point_count += 1;
-    if (static_cast<double>(i) / point_size >= index + 1) {
-      if (index == texture_size - 1 && i < sample_size - 1) continue;
-      float entropy = 0.0f;
-      for (int i = 0; i < 256; ++i) {
-        if (counts[i] > 0) {
-          float fcounts = static_cast<float>(counts[i]) / point_count;
-          entropy -= fcounts * log2(fcounts);
-        }
-      }
-      entropy *= 32; // 256 / 8 (entropy will be in range [0,8], scale it
-      bigtab[index] = entropy;
-      index += 1;
-      point_count = 0;
-      memset(counts, 0, 256 * sizeof(*counts));
-    }
+  // Boundaries come from the sampler, so they're found up front and only
+  // the pyramid is queried in parallel. They're kept for updateRange().
+  exact_boundaries_.assign(1, boundary(0));
+  for (size_t i = 0; i < texture_size; ++i) {
+    if (static_cast<size_t>(i * point_size_) >= sample_size_) break;
+    size_t index = (i == texture_size - 1) ? sample_size_
+        : static_cast<size_t>((i + 1) * point_size_);
+    exact_boundaries_.push_back(std::max(exact_boundaries_.back(),
+                                         boundary(index)));
   }
-  delete[] counts;
-  return bigtab;
-}
-
-float* VisualisationMinimap::calculateEntropyTextureSlidingWindow(
-              const uint8_t *sample, size_t sample_size,
-              size_t texture_size, double point_size) {
-  auto bigtab = new float[texture_size];
-  memset(bigtab, 0, texture_size * sizeof(*bigtab));
-
-  auto counts = new uint64_t[256]; // assume 8-bit bytes
-  memset(counts, 0, 256 * sizeof(*counts));
 
-  size_t start = 0, end = 0;
-  while (start < sample_size) {
-    size_t mid = (start + end) / 2;
-    if (mid > 0 && std::floor(mid / point_size) != std::floor((mid - 1) / point_size)) {
-      float entropy = 0.0f;
-      size_t point_count = end - start;
-      for (int i = 0; i < 256; ++i) {
-        if (counts[i] > 0) {
-          float fcounts = static_cast<float>(counts[i]) / point_count;
-          entropy -= fcounts * log2(fcounts);
-        }
-      }
-      entropy *= 32; // 256 / 8 (entropy will be in range [0,8], scale it
-      bigtab[static_cast<size_t>(mid / point_size)] = entropy;
-    }
-
-    if (end > k_minimum_entropy_window || end >= sample_size) {
-      counts[sample[start++]] -= 1;
+  util::parallelFor(exact_boundaries_.size() - 1, k_exact_pixels_per_task,
+                    [&](size_t first, size_t last) {
+    calculateExactPixels(range, first, last, pixel_stats_.data() + first);
+  });
+}
+
+void VisualisationMinimap::calculateExactPixels(
+    std::pair<size_t, size_t> range, size_t first, size_t last,
+    util::ByteStats *out) {
+  static const util::NLogNTable table(util::NLogNTable::MAX_SIZE);
+  for (size_t i = first; i < last; ++i) {
+    size_t start = exact_boundaries_[i], end = exact_boundaries_[i + 1];
+    // Same minimal window as for the sliding window over the sample.
+    size_t query_start = start, query_end = end;
+    if (end - start < k_minimum_entropy_window) {
+      size_t mid = start + (end - start) / 2;
+      query_start = (mid > range.first + k_minimum_entropy_window / 2)
+          ? mid - k_minimum_entropy_window / 2 : range.first;
+      query_end = std::min(std::min(range.second, stats_pyramid_->size()),
+                           query_start + k_minimum_entropy_window);
     }
-    if (end < sample_size) {
-      counts[sample[end++]] += 1;
+    auto stats = stats_pyramid_->query(query_start, query_end);
+    out[i - first] = util::byteStats(stats.histogram, stats.count, table);
+    if (query_start != start || query_end != end) {
+      // The average is always that of the pixel itself.
+      auto sums = stats_pyramid_->query(start, end, false);
+      out[i - first].average = std::floor(sums.average());
     }
   }
-  delete[] counts;
-  return bigtab;
 }
 
-float* VisualisationMinimap::calculateEntropyTextureSingleWindow(
-              const uint8_t *sample, size_t sample_size,
-              size_t texture_size, double point_size) {
-  auto bigtab = new float[texture_size];
-  memset(bigtab, 0, texture_size * sizeof(*bigtab));
+size_t VisualisationMinimap::pointsPerTask(double point_size) {
+  return std::max(static_cast<size_t>(1),
+                  static_cast<size_t>(k_min_bytes_per_task / point_size));
+}
 
+void VisualisationMinimap::calculateSingleWindowEntropy(
+              const uint8_t *sample, size_t sample_size,
+              size_t texture_size, double point_size, util::ByteStats *out) {
   auto counts = new uint64_t[256]; // assume 8-bit bytes
   memset(counts, 0, 256 * sizeof(*counts));
 
@@ -246,14 +293,39 @@ float* VisualisationMinimap::calculateEntropyTextureSingleWindow(
     if (static_cast<double>(i) / point_size >= index + 1) {
       if (index == texture_size - 1 && i < sample_size - 1) continue;
       float result = (point_count == 0) ? 0.0f : point_sum / point_count;
-      bigtab[index] = static_cast<float>(result) * 32;  // Normalise to 0-256
+      out[index].entropy = result;
       index += 1;
       point_sum = 0;
       point_count = 0;
     }
   }
   delete[] counts;
-  return bigtab;
+}
+
+float VisualisationMinimap::channelValue(const util::ByteStats &stats) {
+  switch (mode_) {
+  case MinimapMode::VALUE:
+    return stats.average;
+  case MinimapMode::ENTROPY:
+    return stats.entropy * 32;  // 256 / 8 (entropy is in range [0,8])
+  case MinimapMode::PRINTABLE:
+    return stats.printable * 256;
+  case MinimapMode::ZEROS:
+    return stats.zeros * 256;
+  case MinimapMode::CHI_SQUARE:
+    return stats.chi_square * 256;
+  }
+  return 0;
+}
+
+void VisualisationMinimap::uploadTexture() {
+  std::vector<float> bigtab(pixel_stats_.size());
+  for (size_t i = 0; i < pixel_stats_.size(); ++i) {
+    bigtab[i] = channelValue(pixel_stats_[i]);
+  }
+  texture_->setData(QOpenGLTexture::Red, QOpenGLTexture::Float32,
+                    reinterpret_cast<void *>(bigtab.data()));
+  texture_->generateMipMaps();
 }
 
 /*****************************************************************************/
@@ -339,23 +411,21 @@ void VisualisationMinimap::initTextures() {
   point_size_ = std::max(1.0, static_cast<double>(sample_size_) / texture_size);
   const uint8_t *rowdata = reinterpret_cast<const uint8_t *>(sampler_->data());
 
-  float* bigtab;
-  if (mode_ == MinimapMode::VALUE) {
-    bigtab = calculateAverageValueTexture(rowdata, sample_size_,
-                                          texture_size, point_size_);
+  // Statistics are computed for all modes at once, so that switching
+  // between them only needs another upload.
+  pixel_stats_.assign(texture_size, util::ByteStats());
+  exact_boundaries_.clear();
+  if (stats_pyramid_ != nullptr && stats_pyramid_->ready()) {
+    calculateExactStats(texture_size);
   } else {
-    bigtab = calculateEntropyTexture(rowdata, sample_size_,
-                                     texture_size, point_size_);
+    calculateSampleStats(rowdata, sample_size_, texture_size, point_size_,
+                         pixel_stats_.data());
   }
 
-  texture_->setData(QOpenGLTexture::Red, QOpenGLTexture::Float32,
-                    reinterpret_cast<void *>(bigtab));
-  texture_->generateMipMaps();
+  uploadTexture();
   texture_->setMinificationFilter(QOpenGLTexture::Nearest);
   texture_->setMagnificationFilter(QOpenGLTexture::Nearest);
   texture_->setWrapMode(QOpenGLTexture::ClampToEdge);
-
-  delete[] bigtab;
 }
 
 void VisualisationMinimap::resizeGL(int w, int h) {
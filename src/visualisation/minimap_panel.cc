@@ -17,10 +17,13 @@
 #include <cmath>
 #include <functional>
 
+#include <QMetaObject>
+#include <QRunnable>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QSpacerItem>
 
+#include "util/settings/visualisation.h"
 #include "visualisation/minimap_panel.h"
 
 
@@ -31,8 +34,35 @@ const float k_minimum_auto_selection_size = 0.1;
 
 typedef VisualisationMinimap::MinimapMode MinimapMode;
 
+namespace {
+
+class BuildStatsPyramidTask : public QRunnable {
+ public:
+  BuildStatsPyramidTask(QObject *receiver,
+                        std::shared_ptr<util::StatsPyramid> pyramid,
+                        std::shared_ptr<std::atomic<bool>> cancelled) :
+      receiver_(receiver), pyramid_(pyramid), cancelled_(cancelled) {}
+
+  void run() override {
+    if (pyramid_->build(cancelled_.get()) && !*cancelled_) {
+      QMetaObject::invokeMethod(receiver_, "statsPyramidReady",
+                                Qt::QueuedConnection);
+    }
+  }
+
+ private:
+  QObject *receiver_;
+  std::shared_ptr<util::StatsPyramid> pyramid_;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+}  // namespace
+
 MinimapPanel::MinimapPanel(QWidget *parent) :
-    QWidget(parent), mode_(MinimapMode::VALUE),
+    QWidget(parent),
+    sample_cache_(std::make_shared<util::SampleCache>(
+        util::settings::visualisation::sampleCacheSize())),
+    mode_(MinimapMode::VALUE),
     select_range_dialog_(new SelectRangeDialog(this)) {
   minimaps_.push_back(new VisualisationMinimap(this));
   connect(minimaps_[0], &VisualisationMinimap::selectionChanged,
@@ -45,9 +75,15 @@ MinimapPanel::MinimapPanel(QWidget *parent) :
 }
 
 MinimapPanel::~MinimapPanel() {
+  if (stats_pyramid_cancelled_) {
+    *stats_pyramid_cancelled_ = true;
+  }
+  // The task still refers to this object.
+  stats_pyramid_pool_.waitForDone();
 }
 
-void MinimapPanel::setSampler(util::ISampler *sampler) {
+void MinimapPanel::setSampler(util::ISampler *sampler,
+                              const data::PieceTable &data) {
   sampler_ = sampler;
   while (minimaps_.size() > 1) {
     removeMinimap();
@@ -56,13 +92,42 @@ void MinimapPanel::setSampler(util::ISampler *sampler) {
     delete minimap_samplers_[0];
     minimap_samplers_.pop_back();
   }
+  sample_cache_->clear();
+  if (stats_pyramid_cancelled_) {
+    *stats_pyramid_cancelled_ = true;
+  }
+  stats_pyramid_ = std::make_shared<util::StatsPyramid>(data);
+  stats_pyramid_cancelled_ = std::make_shared<std::atomic<bool>>(false);
+  stats_pyramid_pool_.start(new BuildStatsPyramidTask(
+      this, stats_pyramid_, stats_pyramid_cancelled_));
   minimap_samplers_.push_back(sampler_->clone());
+  minimap_samplers_[0]->setCache(sample_cache_);
+  minimaps_[0]->setStatsPyramid(stats_pyramid_);
   minimaps_[0]->setSampler(minimap_samplers_[0]);
   select_range_button_->setEnabled(!sampler_->empty());
   auto range = sampler_->getRange();
   selection_ = qMakePair(range.first, range.second);
 }
 
+bool MinimapPanel::updateData(const data::PieceTable &data, size_t start,
+                              size_t end) {
+  if (stats_pyramid_ == nullptr ||
+      !stats_pyramid_->update(data, start, end)) {
+    return false;
+  }
+  // Minimap samplers keep their windows (so pixels still map to the same
+  // offsets), but let go of the old data. So do the cached samples, which
+  // are of no use for the new data anyway.
+  for (auto sampler : minimap_samplers_) {
+    sampler->setData(data);
+  }
+  sample_cache_->clear();
+  for (auto minimap : minimaps_) {
+    minimap->updateRange(start, end);
+  }
+  return true;
+}
+
 QPair<size_t, size_t> MinimapPanel::getSelection() {
   return selection_;
 }
@@ -96,6 +161,7 @@ void MinimapPanel::initLayout() {
   button_layout->addWidget(remove_minimap_button_, 0);
 
   change_mode_button_ = new QPushButton("mode", this);
+  change_mode_button_->setToolTip(getMinimapModeName());
   connect(change_mode_button_, SIGNAL(released()),
           this, SLOT(changeMinimapMode()));
   button_layout->addWidget(change_mode_button_);
@@ -124,6 +190,22 @@ VisualisationMinimap::MinimapColor MinimapPanel::getMinimapColor() {
   }
 }
 
+QString MinimapPanel::getMinimapModeName() {
+  switch(mode_) {
+  case MinimapMode::VALUE:
+    return "average value";
+  case MinimapMode::ENTROPY:
+    return "entropy";
+  case MinimapMode::PRINTABLE:
+    return "printable characters";
+  case MinimapMode::ZEROS:
+    return "zero bytes";
+  case MinimapMode::CHI_SQUARE:
+    return "chi-square (bright for non-random data)";
+  }
+  return QString();
+}
+
 /*****************************************************************************/
 /* Slots */
 /*****************************************************************************/
@@ -133,6 +215,7 @@ void MinimapPanel::addMinimap() {
   auto new_sampler = minimap_samplers_.back()->clone();
   auto range = minimaps_.back()->getSelectedRange();
   new_sampler->setRange(range.first, range.second);
+  new_minimap->setStatsPyramid(stats_pyramid_);
   new_minimap->setSampler(new_sampler);
   new_minimap->setMinimapColor(getMinimapColor());
   new_minimap->setMinimapMode(mode_);
@@ -171,7 +254,14 @@ void MinimapPanel::removeMinimap() {
 }
 
 void MinimapPanel::changeMinimapMode() {
-  mode_ = (mode_ == MinimapMode::VALUE) ? MinimapMode::ENTROPY : MinimapMode::VALUE;
+  switch (mode_) {
+  case MinimapMode::VALUE: mode_ = MinimapMode::ENTROPY; break;
+  case MinimapMode::ENTROPY: mode_ = MinimapMode::PRINTABLE; break;
+  case MinimapMode::PRINTABLE: mode_ = MinimapMode::ZEROS; break;
+  case MinimapMode::ZEROS: mode_ = MinimapMode::CHI_SQUARE; break;
+  case MinimapMode::CHI_SQUARE: mode_ = MinimapMode::VALUE; break;
+  }
+  change_mode_button_->setToolTip(getMinimapModeName());
   auto color = getMinimapColor();
   for (auto minimap : minimaps_) {
     minimap->setMinimapColor(color);
@@ -247,5 +337,12 @@ void MinimapPanel::selectRange() {
   }
 }
 
+void MinimapPanel::statsPyramidReady() {
+  if (stats_pyramid_ == nullptr || !stats_pyramid_->ready()) return;
+  for (auto minimap : minimaps_) {
+    minimap->refresh();
+  }
+}
+
 }  //  namespace visualisation
 }  //  namespace veles
@@ -227,17 +227,18 @@ bool NGramWidget::prepareOptionsPanel(QBoxLayout *layout) {
 }
 
 int NGramWidget::suggestBrightness() {
-  int size = getDataSize();
+  size_t size = getDataSize();
   auto data = reinterpret_cast<const uint8_t*>(getData());
   if (size < 100) {
     return (k_minimum_brightness + k_maximum_brightness) / 2;
   }
   std::vector<uint64_t> counts(256, 0);
-  for (int i = 0; i < size; ++i) {
+  for (size_t i = 0; i < size; ++i) {
     counts[data[i]] += 1;
   }
   std::sort(counts.begin(), counts.end());
-  int offset = 0, sum = 0;
+  int offset = 0;
+  uint64_t sum = 0;
   while (offset < 255 && sum < k_brightness_heuristic_threshold * size) {
     sum += counts[255 - offset];
     offset += 1;
@@ -15,6 +15,8 @@
  *
  */
 #include <QComboBox>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLayoutItem>
@@ -22,16 +24,27 @@
 
 #include "visualisation/panel.h"
 #include "util/sampling/fake_sampler.h"
+#include "util/sampling/importance_sampler.h"
+#include "util/sampling/streaming_sampler.h"
 #include "util/sampling/uniform_sampler.h"
+#include "util/settings/visualisation.h"
 #include "visualisation/ngram.h"
 
 namespace veles {
 namespace visualisation {
 
+// Sampling statistics for every displayed sample. Enable with
+// QT_LOGGING_RULES="veles.visualisation.sampling.debug=true".
+Q_LOGGING_CATEGORY(samplingLog, "veles.visualisation.sampling", QtWarningMsg)
+
 const std::map<QString, VisualisationPanel::ESampler>
   VisualisationPanel::k_sampler_map = {
     {"No sampling", VisualisationPanel::ESampler::NO_SAMPLER},
-    {"Uniform random sampling", VisualisationPanel::ESampler::UNIFORM_SAMPLER}
+    {"Uniform random sampling", VisualisationPanel::ESampler::UNIFORM_SAMPLER},
+    {"Entropy-weighted sampling",
+     VisualisationPanel::ESampler::IMPORTANCE_SAMPLER},
+    {"Streaming reservoir sampling",
+     VisualisationPanel::ESampler::STREAMING_SAMPLER}
 };
 
 /*****************************************************************************/
@@ -42,10 +55,15 @@ VisualisationPanel::VisualisationPanel(QWidget *parent) :
   sampler_type_(k_default_sampler),
   visualisation_type_(k_default_visualisation), sample_size_(1024) {
     sampler_ = getSampler(sampler_type_, data_, sample_size_);
+    sampled_type_ = requested_type_ = sampler_type_;
+    sampled_version_ = requested_version_ = data_.version();
     minimap_sampler_ = getSampler(ESampler::UNIFORM_SAMPLER,
                                   data_, k_minimap_sample_size);
+    async_sampler_ = new util::AsyncSampler(this);
+    connect(async_sampler_, SIGNAL(sampleReady(util::ISampler*)), this,
+            SLOT(sampleReady(util::ISampler*)));
     minimap_ = new MinimapPanel(this);
-    minimap_->setSampler(minimap_sampler_);
+    minimap_->setSampler(minimap_sampler_, data_);
     connect(minimap_, SIGNAL(selectionChanged(size_t, size_t)), this,
             SLOT(minimapSelectionChanged(size_t, size_t)));
 
@@ -54,6 +72,7 @@ VisualisationPanel::VisualisationPanel(QWidget *parent) :
 }
 
 VisualisationPanel::~VisualisationPanel() {
+  delete async_sampler_;
   delete minimap_;
   if (sampler_ != nullptr) {
     delete sampler_;
@@ -63,27 +82,41 @@ VisualisationPanel::~VisualisationPanel() {
   }
 }
 
-void VisualisationPanel::setData(const QByteArray &data) {
-  if (sampler_ != nullptr) {
-    delete sampler_;
-  }
+void VisualisationPanel::setData(const data::PieceTable &data) {
+  // The old sampler keeps its own view of the old data, so it stays
+  // displayed until the new sample is ready. Only the minimap (which uses
+  // a small, fixed sample size) is sampled synchronously.
   if (minimap_sampler_ != nullptr) {
     delete minimap_sampler_;
   }
   data_ = data;
-  sampler_ = getSampler(sampler_type_, data_, sample_size_);
   minimap_sampler_ = getSampler(ESampler::UNIFORM_SAMPLER,
                                 data_, k_minimap_sample_size);
-  minimap_->setSampler(minimap_sampler_);
-  visualisation_->setSampler(sampler_);
-  selection_label_->setText(prepareAddressString(0,
-                            sampler_->getFileOffset(sampler_->getSampleSize() - 1)));
+  minimap_->setSampler(minimap_sampler_, data_);
+  auto selection = minimap_->getSelection();
+  selection_label_->setText(prepareAddressString(selection.first,
+                                                 selection.second));
+  requestSample(selection.first, selection.second);
+}
 
+void VisualisationPanel::updateData(const data::PieceTable &data,
+                                    size_t start, size_t end) {
+  if (data.size() != data_.size() || data.width() != data_.width() ||
+      !minimap_->updateData(data, start, end)) {
+    setData(data);
+    return;
+  }
+  data_ = data;
+  minimap_sampler_->setData(data_);
+  // The visualisation only needs a new sample if the edit is visible in it.
+  auto selection = minimap_->getSelection();
+  if (start <= selection.second && end > selection.first) {
+    requestSample(selection.first, selection.second);
+  }
 }
 
 void VisualisationPanel::setRange(const size_t start, const size_t end) {
-  sampler_->setRange(start, end);
-  refreshVisualisation();
+  requestSample(start, end);
 }
 
 /*****************************************************************************/
@@ -91,17 +124,31 @@ void VisualisationPanel::setRange(const size_t start, const size_t end) {
 /*****************************************************************************/
 
 util::ISampler* VisualisationPanel::getSampler(ESampler type,
-                                          const QByteArray &data,
+                                          const data::PieceTable &data,
                                           int sample_size) {
+  util::ISampler *sampler = nullptr;
   switch (type) {
   case ESampler::NO_SAMPLER:
     return new util::FakeSampler(data);
-  case ESampler::UNIFORM_SAMPLER:
-    util::UniformSampler *sampler = new util::UniformSampler(data);
+  case ESampler::UNIFORM_SAMPLER: {
+    util::UniformSampler *uniform_sampler = new util::UniformSampler(data);
+    uniform_sampler->setProgressive(true);
+    uniform_sampler->setIncremental(true);
+    sampler = uniform_sampler;
+    break;
+  }
+  case ESampler::IMPORTANCE_SAMPLER:
+    sampler = new util::ImportanceSampler(data);
+    break;
+  case ESampler::STREAMING_SAMPLER:
+    sampler = new util::StreamingSampler(data);
+    break;
+  }
+  if (sampler != nullptr) {
     sampler->setSampleSize(1024 * sample_size);
-    return sampler;
+    sampler->setSeed(util::settings::visualisation::samplingSeed());
   }
-  return nullptr;
+  return sampler;
 }
 
 VisualisationWidget* VisualisationPanel::getVisualisation(EVisualisation type,
@@ -135,23 +182,17 @@ void VisualisationPanel::setSamplingMethod(const QString &name) {
   auto new_sampler_type = k_sampler_map.at(name);
   if (new_sampler_type == sampler_type_) return;
 
-  auto old_sampler = sampler_;
-  sampler_ = getSampler(new_sampler_type, data_, sample_size_);
-  auto selection = minimap_->getSelection();
-  sampler_->setRange(selection.first, selection.second);
-  visualisation_->setSampler(sampler_);
-  if (old_sampler != nullptr) {
-    delete old_sampler;
-  }
   sampler_type_ = new_sampler_type;
-  sample_size_box_->setEnabled(sampler_type_ == ESampler::UNIFORM_SAMPLER);
+  sample_size_box_->setEnabled(sampler_type_ != ESampler::NO_SAMPLER);
+  auto selection = minimap_->getSelection();
+  requestSample(selection.first, selection.second);
 }
 
 void VisualisationPanel::setSampleSize(int kilobytes) {
   sample_size_ = kilobytes;
-  if (sampler_type_ == ESampler::UNIFORM_SAMPLER) {
-    sampler_->setSampleSize(1024 * kilobytes);
-    refreshVisualisation();
+  if (sampler_type_ != ESampler::NO_SAMPLER) {
+    auto selection = minimap_->getSelection();
+    requestSample(selection.first, selection.second);
   }
 }
 
@@ -162,8 +203,22 @@ void VisualisationPanel::showNGramVisualisation() {
 
 void VisualisationPanel::minimapSelectionChanged(size_t start, size_t end) {
   selection_label_->setText(prepareAddressString(start, end));
-  sampler_->setRange(start, end);
-  refreshVisualisation();
+  requestSample(start, end);
+}
+
+void VisualisationPanel::sampleReady(util::ISampler *sampler) {
+  auto old_sampler = sampler_;
+  sampler_ = sampler;
+  // Only the last request is ever delivered.
+  sampled_type_ = requested_type_;
+  sampled_version_ = requested_version_;
+  QElapsedTimer timer;
+  timer.start();
+  visualisation_->setSampler(sampler_);
+  logSamplerStats(sampler_, timer.nsecsElapsed());
+  if (old_sampler != nullptr) {
+    delete old_sampler;
+  }
 }
 
 /*****************************************************************************/
@@ -201,6 +256,45 @@ void VisualisationPanel::refreshVisualisation() {
   }
 }
 
+// The sample is prepared in the background and the visualisation switches
+// to it in sampleReady(). A newer request (eg. from dragging the selection
+// further) cancels this one. If the settings and data didn't change, the
+// displayed sampler is cloned along with its sample, so that the incremental
+// UniformSampler only has to read the windows missing in the new range.
+void VisualisationPanel::requestSample(size_t start, size_t end) {
+  util::ISampler *sampler;
+  if (sampler_ != nullptr && sampled_type_ == sampler_type_ &&
+      sampled_version_ == data_.version() &&
+      sampler_->getSeed() == util::settings::visualisation::samplingSeed()) {
+    sampler = sampler_->clone();
+    sampler->setSampleSize(1024 * sample_size_);
+    // sampler_ can be a coarse pass of a progressive sample.
+    sampler->setPass(SIZE_MAX);
+  } else {
+    sampler = getSampler(sampler_type_, data_, sample_size_);
+  }
+  requested_type_ = sampler_type_;
+  requested_version_ = data_.version();
+  if (!sampler->empty()) {
+    sampler->setRange(start, end);
+  }
+  async_sampler_->request(sampler);
+}
+
+void VisualisationPanel::logSamplerStats(util::ISampler *sampler,
+                                         qint64 refresh_ns) {
+  if (!samplingLog().isDebugEnabled()) return;
+  const util::SamplerStats &stats = sampler->getStats();
+  qCDebug(samplingLog).nospace()
+      << "sample of " << sampler->getSampleSize() << " bytes: "
+      << stats.initialisations << " sampling(s) in "
+      << stats.initialise_ns / 1000 << "us, data() "
+      << stats.data_ns / 1000 << "us, "
+      << stats.bytes_read << " bytes read, cache "
+      << stats.cache_hits << "/" << stats.cache_hits + stats.cache_misses
+      << " hits, refresh " << refresh_ns / 1000 << "us";
+}
+
 void VisualisationPanel::initLayout() {
   initOptionsPanel();
 
@@ -232,6 +326,8 @@ void VisualisationPanel::initOptionsPanel() {
 
   QComboBox *sampling_method = new QComboBox;
   sampling_method->addItem("Uniform random sampling");
+  sampling_method->addItem("Entropy-weighted sampling");
+  sampling_method->addItem("Streaming reservoir sampling");
   sampling_method->addItem("No sampling");
   options_layout_->addWidget(sampling_method);
 
@@ -244,7 +340,7 @@ void VisualisationPanel::initOptionsPanel() {
   sample_size_box_->setMaximum(k_max_sample_size);
   sample_size_box_->setSingleStep(1024);
   sample_size_box_->setValue(sample_size_);
-  sample_size_box_->setEnabled(sampler_type_ == ESampler::UNIFORM_SAMPLER);
+  sample_size_box_->setEnabled(sampler_type_ != ESampler::NO_SAMPLER);
   options_layout_->addWidget(sample_size_box_);
 
   connect(sampling_method, SIGNAL(currentIndexChanged(const QString&)),
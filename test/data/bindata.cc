@@ -17,6 +17,8 @@
 #include "gtest/gtest.h"
 #include "data/bindata.h"
 #include <algorithm>
+#include <QTemporaryFile>
+#include <vector>
 
 namespace veles {
 namespace data {
@@ -371,6 +373,89 @@ TEST(BinData, SetData23) {
   EXPECT_EQ(a.rawData()[12], 13);
 }
 
+TEST(BinData, SharedCopy) {
+  const BinData a(8, {1, 2, 3, 4, 5, 6});
+  const BinData b(a);
+  BinData c;
+  c = a;
+  EXPECT_EQ(b.rawData(), a.rawData());
+  EXPECT_EQ(static_cast<const BinData &>(c).rawData(), a.rawData());
+}
+
+TEST(BinData, SharedData) {
+  const BinData a(8, {1, 2, 3, 4, 5, 6});
+  const BinData b = a.data(2, 5);
+  EXPECT_EQ(b.rawData(), a.rawData(2));
+  EXPECT_EQ(b.size(), 3);
+  const BinData c = b.data(1, 3);
+  EXPECT_EQ(c.rawData(), a.rawData(3));
+  EXPECT_EQ(c.element64(0), 4);
+  EXPECT_EQ(c.element64(1), 5);
+}
+
+TEST(BinData, DetachSetData) {
+  const BinData a(8, {1, 2, 3, 4, 5, 6});
+  BinData b(a);
+  b.setData(1, 3, BinData(8, {7, 8}));
+  EXPECT_NE(static_cast<const BinData &>(b).rawData(), a.rawData());
+  EXPECT_EQ(a.element64(1), 2);
+  EXPECT_EQ(a.element64(2), 3);
+  EXPECT_EQ(b.element64(0), 1);
+  EXPECT_EQ(b.element64(1), 7);
+  EXPECT_EQ(b.element64(2), 8);
+  EXPECT_EQ(b.element64(3), 4);
+}
+
+TEST(BinData, DetachSlice) {
+  BinData a(8, {1, 2, 3, 4, 5, 6});
+  BinData b = a.data(2, 5);
+  b.setElement64(0, 9);
+  a.setBits64(3, 0, 4, 0xa);
+  EXPECT_EQ(a.element64(2), 3);
+  EXPECT_EQ(a.element64(3), 0xa);
+  EXPECT_EQ(b.element64(0), 9);
+  EXPECT_EQ(b.element64(1), 4);
+  EXPECT_EQ(b.size(), 3);
+}
+
+TEST(BinData, DetachSetBits) {
+  const BinData a(8, {0xff, 0xff, 0xff});
+  BinData b(a);
+  b.setBits(1, 2, 4, BinData(4, {0}));
+  EXPECT_EQ(a.element64(1), 0xff);
+  EXPECT_EQ(b.element64(1), 0xc3);
+}
+
+TEST(BinData, FromFile) {
+  QTemporaryFile file;
+  ASSERT_TRUE(file.open());
+  QByteArray contents(10000, 0);
+  for (int i = 0; i < contents.size(); i++)
+    contents[i] = i * 7;
+  file.write(contents);
+  file.flush();
+  bool ok = false;
+  BinData a = BinData::fromFile(file.fileName(), &ok);
+  EXPECT_TRUE(ok);
+  EXPECT_EQ(a.width(), 8);
+  EXPECT_EQ(a.size(), 10000);
+  for (size_t i = 0; i < a.size(); i++)
+    EXPECT_EQ(a.element64(i), (i * 7) & 0xff);
+  a.setElement64(1, 0x42);
+  EXPECT_EQ(a.element64(0), 0);
+  EXPECT_EQ(a.element64(1), 0x42);
+  EXPECT_EQ(a.element64(2), 14);
+  BinData b = BinData::fromFile(file.fileName());
+  EXPECT_EQ(b.element64(1), 7);
+}
+
+TEST(BinData, FromFileMissing) {
+  bool ok = true;
+  BinData a = BinData::fromFile("/nonexistent/veles/file", &ok);
+  EXPECT_FALSE(ok);
+  EXPECT_EQ(a.size(), 0);
+}
+
 TEST(BinData, Bits64) {
   BinData a = BinData::fromRawData(23, {1, 2, 3, 4, 5, 6});
   EXPECT_EQ(a.bits64(1, 0, 23), 0x060504);
@@ -459,5 +544,41 @@ TEST(BinData, ToString) {
   EXPECT_EQ(BinData::fromRawData(72, {1, 2, 3, 4, 5, 6, 7, 8, 9}).toString(2),
             "0x090807060504030201");
 }
+
+TEST(BinData, Elements) {
+  BinData a(8, {1, 2, 0xff});
+  auto bytes = a.elements<uint8_t>();
+  EXPECT_EQ(bytes.size(), 3);
+  EXPECT_EQ(bytes.rawData(), a.rawData());
+  EXPECT_EQ(std::vector<uint8_t>(bytes.begin(), bytes.end()),
+            std::vector<uint8_t>({1, 2, 0xff}));
+  BinData b(32, {0x12345678, 0xdeadbeef});
+  auto words = b.elements<uint32_t>();
+  EXPECT_EQ(words.size(), 2);
+  EXPECT_EQ(words[0], 0x12345678);
+  EXPECT_EQ(words[1], 0xdeadbeef);
+  EXPECT_EQ(words.end() - words.begin(), 2);
+  EXPECT_EQ(*std::max_element(words.begin(), words.end()), 0xdeadbeef);
+  BinData c(64, {0x0123456789abcdefull});
+  EXPECT_EQ(c.elements<uint64_t>()[0], 0x0123456789abcdefull);
+  EXPECT_TRUE(BinData(16, 0).elements<uint16_t>().empty());
+}
+
+TEST(BinData, ElementReader) {
+  for (unsigned width : {1, 7, 8, 12, 23, 32, 57, 64}) {
+    BinData a(width, 37);
+    for (size_t i = 0; i < a.size(); i++)
+      a.setElement64(i, i * 0x9e3779b97f4a7c15ull);
+    auto reader = a.elementReader();
+    EXPECT_EQ(reader.size(), a.size());
+    for (size_t i = 0; i < a.size(); i++)
+      EXPECT_EQ(reader[i], a.element64(i));
+  }
+  // Bits above the width in the raw data must be ignored.
+  BinData b = BinData::fromRawData(12, {0x34, 0xf2, 0x56, 0xf4});
+  auto reader = b.elementReader();
+  EXPECT_EQ(std::vector<uint64_t>(reader.begin(), reader.end()),
+            std::vector<uint64_t>({0x234, 0x456}));
+}
 }
 }
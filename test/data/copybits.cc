@@ -16,6 +16,7 @@
  */
 #include "gtest/gtest.h"
 #include "data/bindata.h"
+#include <vector>
 
 namespace veles {
 namespace data {
@@ -88,5 +89,30 @@ TEST(CopyTest, ShiftOffset) {
   EXPECT_EQ(dst[7], 0xa7);
 }
 
+TEST(CopyTest, LongRanges) {
+  // Compare against a trivial bit-by-bit copy, for every combination of
+  // alignments and for lengths that hit the word and vector loops.
+  const unsigned k_max_bits = 1200;
+  std::vector<uint8_t> src(k_max_bits / 8 + 2);
+  for (size_t i = 0; i < src.size(); i++)
+    src[i] = (i * 151 + 37) ^ (i >> 3);
+  for (unsigned dst_bit = 0; dst_bit < 16; dst_bit++) {
+    for (unsigned src_bit = 0; src_bit < 16; src_bit++) {
+      for (unsigned num_bits = 0; num_bits + 16 <= k_max_bits; num_bits += 61) {
+        std::vector<uint8_t> dst(src.size(), 0xa5);
+        std::vector<uint8_t> expected(dst);
+        for (unsigned i = 0; i < num_bits; i++) {
+          unsigned s = src_bit + i, d = dst_bit + i;
+          uint8_t bit = (src[s >> 3] >> (s & 7)) & 1;
+          expected[d >> 3] &= ~(1 << (d & 7));
+          expected[d >> 3] |= bit << (d & 7);
+        }
+        BinData::copyBits(dst.data(), dst_bit, src.data(), src_bit, num_bits);
+        EXPECT_EQ(dst, expected) << dst_bit << " " << src_bit << " " << num_bits;
+      }
+    }
+  }
+}
+
 }
 }
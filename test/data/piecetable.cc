@@ -0,0 +1,213 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "data/piecetable.h"
+#include <random>
+#include <vector>
+
+namespace veles {
+namespace data {
+
+static void expectContents(const PieceTable &table,
+                           const std::vector<uint8_t> &expected) {
+  ASSERT_EQ(table.size(), expected.size());
+  BinData all = table.data();
+  EXPECT_EQ(all.width(), 8);
+  ASSERT_EQ(all.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++)
+    EXPECT_EQ(all.element64(i), expected[i]);
+}
+
+TEST(PieceTable, Simple) {
+  BinData a(8, {1, 2, 3, 4, 5});
+  PieceTable table(a);
+  EXPECT_EQ(table.width(), 8);
+  EXPECT_EQ(table.size(), 5);
+  EXPECT_EQ(table.pieceCount(), 1);
+  expectContents(table, {1, 2, 3, 4, 5});
+  PieceTable empty;
+  EXPECT_EQ(empty.size(), 0);
+  EXPECT_EQ(empty.pieceCount(), 0);
+  EXPECT_EQ(empty.data().size(), 0);
+}
+
+TEST(PieceTable, Replace) {
+  PieceTable table(BinData(8, {1, 2, 3, 4, 5}));
+  table.replace(1, 3, BinData(8, {7, 8}));
+  expectContents(table, {1, 7, 8, 4, 5});
+  table.replace(2, 2, BinData(8, {9, 9, 9}));
+  expectContents(table, {1, 7, 9, 9, 9, 8, 4, 5});
+  table.replace(0, 3, BinData(8, 0));
+  expectContents(table, {9, 9, 8, 4, 5});
+  table.replace(5, 5, BinData(8, {6}));
+  expectContents(table, {9, 9, 8, 4, 5, 6});
+  table.replace(0, 6, BinData(8, 0));
+  expectContents(table, {});
+  table.replace(0, 0, BinData(8, {3}));
+  expectContents(table, {3});
+}
+
+static const uint8_t *rawData(const BinData &data) {
+  return data.rawData();
+}
+
+TEST(PieceTable, SharedPieces) {
+  BinData a(8, 0x100000);
+  for (size_t i = 0; i < a.size(); i++)
+    a.setElement64(i, i & 0xff);
+  PieceTable table(a);
+  const BinData &ca = a;
+  EXPECT_EQ(rawData(table.data()), ca.rawData());
+  // Inserting an element leaves the big pieces shared with the original.
+  table.replace(0x80000, 0x80000, BinData(8, {0xaa}));
+  EXPECT_EQ(table.size(), 0x100001);
+  EXPECT_EQ(table.pieceCount(), 3);
+  EXPECT_EQ(rawData(table.data(0, 0x80000)), ca.rawData());
+  EXPECT_EQ(rawData(table.data(0x80001, 0x100001)), ca.rawData(0x80000));
+  BinData around = table.data(0x7ffff, 0x80002);
+  EXPECT_EQ(around.size(), 3);
+  EXPECT_EQ(around.element64(0), 0xff);
+  EXPECT_EQ(around.element64(1), 0xaa);
+  EXPECT_EQ(around.element64(2), 0x00);
+}
+
+TEST(PieceTable, MergeSmall) {
+  PieceTable table(BinData(8, 0x100000));
+  // Typing byte by byte shouldn't create a piece per byte.
+  for (uint64_t i = 0; i < 1000; i++)
+    table.replace(0x1000 + i, 0x1000 + i, BinData(8, {i & 0xff}));
+  EXPECT_EQ(table.size(), 0x100000 + 1000);
+  EXPECT_LE(table.pieceCount(), 3);
+  BinData typed = table.data(0x1000, 0x1000 + 1000);
+  for (uint64_t i = 0; i < 1000; i++)
+    EXPECT_EQ(typed.element64(i), i & 0xff);
+}
+
+TEST(PieceTable, Snapshots) {
+  PieceTable table(BinData(8, {1, 2, 3, 4, 5}));
+  PieceTable copy = table;
+  EXPECT_EQ(copy.version(), table.version());
+  table.replace(1, 3, BinData(8, {7, 8, 9}));
+  EXPECT_NE(copy.version(), table.version());
+  expectContents(table, {1, 7, 8, 9, 4, 5});
+  expectContents(copy, {1, 2, 3, 4, 5});
+  copy.replace(0, 1, BinData(8, 0));
+  expectContents(table, {1, 7, 8, 9, 4, 5});
+  expectContents(copy, {2, 3, 4, 5});
+}
+
+TEST(PieceTable, Slice) {
+  BinData a(8, 0x10000);
+  for (size_t i = 0; i < a.size(); i++)
+    a.setElement64(i, i & 0xff);
+  PieceTable table(a);
+  table.replace(0x4000, 0x4000, BinData(8, 0x2000));
+  table.replace(0x9000, 0x9000, BinData(8, 0x2000));
+  EXPECT_EQ(table.pieceCount(), 5);
+  PieceTable slice = table.slice(0x1000, 0xa000);
+  EXPECT_EQ(slice.size(), 0x9000);
+  EXPECT_EQ(slice.pieceCount(), 4);
+  EXPECT_EQ(slice.element64(0), 0x00);
+  EXPECT_EQ(slice.element64(0x2fff), 0xff);
+  EXPECT_EQ(slice.element64(0x3000), 0x00);
+  EXPECT_EQ(slice.element64(0x5000), 0x00);
+  EXPECT_EQ(slice.element64(0x5001), 0x01);
+  EXPECT_EQ(slice.element64(0x8000), 0x00);
+  BinData all = table.data();
+  BinData sliced = slice.data();
+  for (size_t i = 0; i < sliced.size(); i++)
+    ASSERT_EQ(sliced.element64(i), all.element64(0x1000 + i));
+  EXPECT_EQ(table.slice(0x10, 0x10).size(), 0);
+  EXPECT_EQ(table.slice(0, table.size()).pieceCount(), 5);
+}
+
+TEST(PieceTable, Pieces) {
+  BinData a(8, 0x10000);
+  for (size_t i = 0; i < a.size(); i++)
+    a.setElement64(i, i & 0xff);
+  PieceTable table(a);
+  table.replace(0x8000, 0x8000, BinData(8, 0x2000));
+  const BinData &ca = a;
+  auto pieces = table.pieces(0x7000, 0xb000);
+  ASSERT_EQ(pieces.size(), 3);
+  EXPECT_EQ(pieces[0].size(), 0x1000);
+  EXPECT_EQ(rawData(pieces[0]), ca.rawData(0x7000));
+  EXPECT_EQ(pieces[1].size(), 0x2000);
+  EXPECT_EQ(pieces[2].size(), 0x1000);
+  EXPECT_EQ(rawData(pieces[2]), ca.rawData(0x8000));
+  EXPECT_EQ(table.pieces(0x100, 0x200).size(), 1);
+  EXPECT_EQ(table.pieces(0x100, 0x100).size(), 0);
+}
+
+TEST(PieceTable, ManyPieces) {
+  // Scattered edits should keep every operation cheap, and shouldn't
+  // be limited by the recursion depth.
+  const uint64_t size = 0x4000000;
+  PieceTable table(BinData(8, size));
+  std::mt19937 gen(2);
+  std::vector<uint64_t> positions;
+  for (int i = 0; i < 20000; i++) {
+    uint64_t pos = gen() % size;
+    table.replace(pos, pos + 1, BinData(8, {1}));
+    positions.push_back(pos);
+  }
+  EXPECT_EQ(table.size(), size);
+  EXPECT_GT(table.pieceCount(), 20000);
+  PieceTable copy = table;
+  for (auto pos : positions)
+    table.replace(pos, pos + 1, BinData(8, {0}));
+  for (auto pos : positions) {
+    ASSERT_EQ(copy.element64(pos), 1);
+    ASSERT_EQ(table.element64(pos), 0);
+  }
+}
+
+TEST(PieceTable, RandomEdits) {
+  std::mt19937 gen(1);
+  std::vector<uint8_t> expected(10000);
+  for (size_t i = 0; i < expected.size(); i++)
+    expected[i] = gen();
+  PieceTable table(BinData(8, expected.size(), expected.data()));
+  for (int iter = 0; iter < 200; iter++) {
+    uint64_t start = gen() % (expected.size() + 1);
+    uint64_t end = start + gen() % (expected.size() - start + 1) % 3000;
+    std::vector<uint8_t> inserted(gen() % 3000);
+    for (auto &x : inserted)
+      x = gen();
+    table.replace(start, end, BinData(8, inserted.size(), inserted.data()));
+    expected.erase(expected.begin() + start, expected.begin() + end);
+    expected.insert(expected.begin() + start, inserted.begin(), inserted.end());
+    ASSERT_EQ(table.size(), expected.size());
+    uint64_t rstart = gen() % (expected.size() + 1);
+    uint64_t rend = rstart + gen() % (expected.size() - rstart + 1);
+    BinData range = table.data(rstart, rend);
+    ASSERT_EQ(range.size(), rend - rstart);
+    for (uint64_t i = rstart; i < rend; i++)
+      ASSERT_EQ(range.element64(i - rstart), expected[i]);
+    PieceTable slice = table.slice(rstart, rend);
+    uint64_t pos = rstart;
+    for (const auto &piece : slice.pieces(0, slice.size())) {
+      for (size_t i = 0; i < piece.size(); i++, pos++)
+        ASSERT_EQ(piece.element64(i), expected[pos]);
+    }
+    ASSERT_EQ(pos, rend);
+  }
+  expectContents(table, expected);
+}
+
+}
+}
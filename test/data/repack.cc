@@ -16,6 +16,8 @@
  */
 #include "gtest/gtest.h"
 #include "data/repack.h"
+#include <algorithm>
+#include <vector>
 
 namespace veles {
 namespace data {
@@ -250,5 +252,128 @@ TEST(Repack, Padded8to23MixedBig) {
   EXPECT_EQ(b.element64(1), 0x667788);
 }
 
+TEST(Repack, Gather8To32Big) {
+  BinData a(8, {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99});
+  RepackFormat format{RepackEndian::BIG, 32};
+  EXPECT_EQ(repackUnit(a.width(), format), 32);
+  EXPECT_EQ(repackSize(a.width(), format, 2), 8);
+  BinData b = repack(a, format, 1, 2);
+  EXPECT_EQ(b.size(), 2);
+  EXPECT_EQ(b.width(), 32);
+  EXPECT_EQ(b.element64(0), 0x22334455);
+  EXPECT_EQ(b.element64(1), 0x66778899);
+}
+
+TEST(Repack, GatherOctetMultiples) {
+  // Long enough to cover both the vectorized loop and its tail.
+  const size_t num_elements = 37;
+  BinData a(8, num_elements * 8 + 1);
+  for (size_t i = 0; i < a.size(); i++)
+    a.setElement64(i, (i * 0x9d + 0x31) & 0xff);
+  for (unsigned width : {16, 24, 32, 40, 64}) {
+    unsigned octets = width / 8;
+    for (auto endian : {RepackEndian::LITTLE, RepackEndian::BIG}) {
+      RepackFormat format{endian, width};
+      BinData b = repack(a, format, 1, num_elements);
+      EXPECT_EQ(b.size(), num_elements);
+      EXPECT_EQ(b.width(), width);
+      for (size_t i = 0; i < num_elements; i++) {
+        uint64_t expected = 0;
+        for (unsigned j = 0; j < octets; j++) {
+          unsigned k = endian == RepackEndian::LITTLE ? octets - j - 1 : j;
+          expected = expected << 8 | a.element64(1 + i * octets + k);
+        }
+        EXPECT_EQ(b.element64(i), expected);
+      }
+    }
+  }
+}
+
+template<typename Format>
+void checkStaticFormat(const BinData &src) {
+  RepackFormat format = Format::format();
+  EXPECT_EQ(Format::octets() * 8, format.width);
+  EXPECT_EQ(format.lowPad, 0);
+  EXPECT_EQ(format.highPad, 0);
+  for (size_t i = 0; i + Format::octets() <= src.size(); i++)
+    EXPECT_EQ(Format::decode(src.rawData(i)),
+              repack(src, format, i, 1).element64());
+}
+
+TEST(Repack, StaticFormats) {
+  BinData a(8, {0x81, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0xf9, 0xaa});
+  checkStaticFormat<RepackByte>(a);
+  checkStaticFormat<RepackLe16>(a);
+  checkStaticFormat<RepackBe16>(a);
+  checkStaticFormat<RepackLe32>(a);
+  checkStaticFormat<RepackBe32>(a);
+  checkStaticFormat<RepackLe64>(a);
+  checkStaticFormat<RepackBe64>(a);
+  EXPECT_EQ(RepackBe32::decode(a.rawData(1)), 0x22334455);
+  EXPECT_EQ(RepackLe16::decode(a.rawData(8)), 0xaaf9);
+}
+
+TEST(Repack, Cursor) {
+  BinData a(8, 1000);
+  for (size_t i = 0; i < a.size(); i++)
+    a.setElement64(i, (i * 0x9d + 0x31) & 0xff);
+  std::vector<RepackFormat> formats = {
+    {RepackEndian::LITTLE, 8},
+    {RepackEndian::BIG, 16},
+    {RepackEndian::LITTLE, 12},
+    {RepackEndian::BIG, 12},
+    {RepackEndian::BIG, 1},
+    {RepackEndian::LITTLE, 23, 1, 8},
+    {RepackEndian::BIG, 23, 0, 9},
+  };
+  for (auto format : formats) {
+    for (size_t batch_size : {1, 5, 7, 64, 4096}) {
+      BinData expected = repack(a, format, 3, 5000);
+      RepackCursor cursor(a, format, 3, 5000, batch_size);
+      EXPECT_EQ(cursor.size(), expected.size());
+      size_t pos = 0;
+      while (!cursor.atEnd()) {
+        EXPECT_EQ(cursor.pos(), pos);
+        BinData batch = cursor.next();
+        ASSERT_GT(batch.size(), 0);
+        EXPECT_LE(batch.size(), std::max<size_t>(batch_size, 24));
+        EXPECT_EQ(batch.width(), format.width);
+        for (size_t i = 0; i < batch.size(); i++)
+          ASSERT_EQ(batch.element64(i), expected.element64(pos + i));
+        pos += batch.size();
+      }
+      EXPECT_EQ(pos, expected.size());
+      EXPECT_EQ(cursor.next().size(), 0);
+    }
+  }
+}
+
+TEST(Repack, CursorPieces) {
+  BinData a(8, 20000);
+  for (size_t i = 0; i < a.size(); i++)
+    a.setElement64(i, (i * 0x9d + 0x31) & 0xff);
+  // Same contents, split into pieces which batches have to straddle.
+  PieceTable table(BinData(8, a.size()));
+  table.replace(0, 7001, a.data(0, 7001));
+  table.replace(7001, 14003, a.data(7001, 14003));
+  table.replace(14003, 20000, a.data(14003, 20000));
+  ASSERT_GE(table.pieceCount(), 3);
+  for (auto format : {RepackFormat{RepackEndian::BIG, 12},
+                      RepackFormat{RepackEndian::LITTLE, 23, 1, 8},
+                      RepackFormat{RepackEndian::BIG, 64}}) {
+    BinData expected = repack(a, format, 3, 15000);
+    RepackCursor cursor(table, format, 3, 15000, 1000);
+    EXPECT_EQ(cursor.size(), expected.size());
+    size_t pos = 0;
+    while (!cursor.atEnd()) {
+      BinData batch = cursor.next();
+      for (size_t i = 0; i < batch.size(); i++)
+        ASSERT_EQ(batch.element64(i), expected.element64(pos + i));
+      pos += batch.size();
+    }
+    EXPECT_EQ(pos, expected.size());
+  }
+}
+
 }
 }
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "db/db.h"
+#include "dbif/method.h"
+#include "dbif/universe.h"
+#include "parser/stream.h"
+
+namespace veles {
+namespace parser {
+
+static dbif::ObjectHandle createBlob(const data::BinData &data) {
+  dbif::ObjectHandle root = db::create_db();
+  return root->syncRunMethod<dbif::RootCreateFileBlobFromDataRequest>(
+    data, "blob")->object;
+}
+
+TEST(StreamParser, fields) {
+  auto blob = createBlob(data::BinData(8, {
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a
+  }));
+  StreamParser parser(blob, 0);
+  parser.startChunk("test", "file");
+  EXPECT_EQ(parser.getLe32("le32"), 0x04030201);
+  EXPECT_EQ(parser.getBytes("bytes", 2), std::vector<uint8_t>({0x05, 0x06}));
+  EXPECT_EQ(parser.getLe16("le16", 2),
+            std::vector<uint16_t>({0x0807, 0x0a09}));
+  EXPECT_EQ(parser.pos(), 10);
+  EXPECT_TRUE(parser.eof());
+  parser.endChunk();
+}
+
+TEST(StreamParser, pastEnd) {
+  auto blob = createBlob(data::BinData(8, {0x01, 0x02, 0x03, 0x04}));
+  StreamParser parser(blob, 0);
+  parser.startChunk("test", "file");
+  EXPECT_EQ(parser.getLe16("le16", 2),
+            std::vector<uint16_t>({0x0201, 0x0403}));
+  EXPECT_TRUE(parser.eof());
+  EXPECT_TRUE(parser.getLe16("le16", 2).empty());
+  EXPECT_TRUE(parser.getBytes("bytes", 4).empty());
+  EXPECT_EQ(parser.getLe32("le32"), 0);
+  EXPECT_EQ(parser.getByte("byte"), 0);
+  parser.endChunk();
+}
+
+}  // namespace parser
+}  // namespace veles
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "util/parallel.h"
+
+#include <atomic>
+#include <vector>
+
+namespace veles {
+namespace util {
+
+TEST(ParallelFor, coversAllItemsOnce) {
+  for (size_t count : {0, 1, 10, 1000, 100003}) {
+    std::vector<std::atomic<int>> visits(count);
+    for (auto &visit : visits) {
+      visit = 0;
+    }
+    std::atomic<size_t> chunks(0);
+    parallelFor(count, 16, [&](size_t begin, size_t end) {
+      EXPECT_LT(begin, end);
+      chunks += 1;
+      for (size_t i = begin; i < end; ++i) {
+        visits[i] += 1;
+      }
+    });
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_EQ(visits[i], 1) << count << " " << i;
+    }
+    EXPECT_LE(chunks * 16, std::max<size_t>(count, 16));
+  }
+}
+
+}  // namespace util
+}  // namespace veles
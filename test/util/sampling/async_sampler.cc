@@ -0,0 +1,215 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QSemaphore>
+
+#include "gtest/gtest.h"
+#include "util/sampling/async_sampler.h"
+
+namespace veles {
+namespace util {
+
+namespace {
+
+/**
+ * Shared by GatedSampler and its clones: lets the test hold the sampling
+ * until it opens the gate, and counts the live samplers.
+ */
+struct Gate {
+  QSemaphore started;
+  QSemaphore open;
+  std::atomic<int> alive{0};
+};
+
+/**
+ * A sampler passing its input through, whose sampling blocks until the
+ * gate is opened.
+ */
+class GatedSampler : public ISampler {
+ public:
+  GatedSampler(const data::PieceTable &data, std::shared_ptr<Gate> gate) :
+      ISampler(data), gate_(gate) {
+    ++gate_->alive;
+  }
+  ~GatedSampler() {
+    --gate_->alive;
+  }
+  GatedSampler* clone() override {
+    return new GatedSampler(*this);
+  }
+
+ protected:
+  GatedSampler(const GatedSampler &other) : ISampler(other),
+      gate_(other.gate_) {
+    ++gate_->alive;
+  }
+  size_t getRealSampleSize() override {
+    return getDataSize();
+  }
+
+ private:
+  void initialiseSample(size_t size) override {
+    gate_->started.release();
+    gate_->open.acquire();
+    gate_->open.release();
+  }
+  char getSampleByte(size_t index) override {
+    return getDataByte(index);
+  }
+  const char* getData() override {
+    return getRawData();
+  }
+  size_t getFileOffsetImpl(size_t index) override {
+    return index;
+  }
+  size_t getSampleOffsetImpl(size_t address) override {
+    return address;
+  }
+  void resampleImpl() override {}
+
+  std::shared_ptr<Gate> gate_;
+};
+
+data::BinData testData() {
+  data::BinData data(8, 0x1000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, i & 0xff);
+  }
+  return data;
+}
+
+/**
+ * Process events until count samplers got delivered (or a timeout passes).
+ */
+bool waitForSamples(const std::vector<std::unique_ptr<ISampler>> &delivered,
+                    size_t count) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (delivered.size() < count) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    QCoreApplication::processEvents();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(AsyncSampler, deliversSample) {
+  auto gate = std::make_shared<Gate>();
+  gate->open.release();
+  std::vector<std::unique_ptr<ISampler>> delivered;
+  AsyncSampler async;
+  QObject::connect(&async, &AsyncSampler::sampleReady,
+                   [&delivered](ISampler *sampler) {
+                     delivered.emplace_back(sampler);
+                   });
+
+  auto sampler = new GatedSampler(testData(), gate);
+  sampler->setSampleSize(0x800);
+  async.request(sampler);
+  ASSERT_TRUE(waitForSamples(delivered, 1));
+  EXPECT_EQ(delivered[0].get(), sampler);
+  EXPECT_FALSE(async.busy());
+  ASSERT_EQ(sampler->getSampleSize(), 0xfff);
+  EXPECT_EQ(sampler->data()[0x123], 0x23);
+}
+
+TEST(AsyncSampler, newerRequestCancelsOlder) {
+  auto gate = std::make_shared<Gate>();
+  std::vector<std::unique_ptr<ISampler>> delivered;
+  std::unique_ptr<AsyncSampler> async(new AsyncSampler);
+  QObject::connect(async.get(), &AsyncSampler::sampleReady,
+                   [&delivered](ISampler *sampler) {
+                     delivered.emplace_back(sampler);
+                   });
+
+  auto older = new GatedSampler(testData(), gate);
+  older->setSampleSize(0x800);
+  ISampler *newer = older->clone();
+  newer->setRange(0x100, 0x200);
+  async->request(older);
+  // Make sure the older one is being sampled when it gets cancelled.
+  ASSERT_TRUE(gate->started.tryAcquire(1, 10000));
+  async->request(newer);
+  EXPECT_TRUE(async->busy());
+  gate->open.release();
+
+  ASSERT_TRUE(waitForSamples(delivered, 1));
+  EXPECT_EQ(delivered[0].get(), newer);
+  EXPECT_EQ(newer->getRange().first, 0x100);
+  EXPECT_EQ(newer->getRange().second, 0x200);
+  EXPECT_FALSE(async->busy());
+  // Waits for the workers, the older sampler must not show up and is
+  // freed by now.
+  async.reset();
+  QCoreApplication::processEvents();
+  EXPECT_EQ(delivered.size(), 1);
+  EXPECT_EQ(gate->alive, 1);
+}
+
+TEST(AsyncSampler, previousSampleStaysCurrent) {
+  auto gate = std::make_shared<Gate>();
+  gate->open.release();
+  std::vector<std::unique_ptr<ISampler>> delivered;
+  AsyncSampler async;
+  QObject::connect(&async, &AsyncSampler::sampleReady,
+                   [&delivered](ISampler *sampler) {
+                     delivered.emplace_back(sampler);
+                   });
+
+  auto first = new GatedSampler(testData(), gate);
+  first->setSampleSize(0x800);
+  async.request(first);
+  ASSERT_TRUE(waitForSamples(delivered, 1));
+  ASSERT_TRUE(gate->started.tryAcquire(1, 10000));
+  const char *first_data = first->data();
+
+  // Close the gate, so that the next sample takes its time.
+  gate->open.acquire();
+  ISampler *next = first->clone();
+  next->setRange(0x400, 0xc00);
+  next->setSampleSize(0x400);
+  async.request(next);
+  ASSERT_TRUE(gate->started.tryAcquire(1, 10000));
+  QCoreApplication::processEvents();
+  EXPECT_EQ(delivered.size(), 1);
+  EXPECT_TRUE(async.busy());
+  // The displayed sampler is unaffected by the request in progress.
+  EXPECT_EQ(first->data(), first_data);
+  EXPECT_EQ(first->getSampleSize(), 0xfff);
+  EXPECT_EQ(first->getRange().first, 0);
+  EXPECT_EQ(first_data[0x123], 0x23);
+
+  gate->open.release();
+  ASSERT_TRUE(waitForSamples(delivered, 2));
+  EXPECT_EQ(delivered[1].get(), next);
+  EXPECT_EQ(next->getSampleSize(), 0x800);
+  EXPECT_EQ(next->getRange().first, 0x400);
+  EXPECT_EQ(next->data()[0x123], 0x23);
+  EXPECT_FALSE(async.busy());
+}
+
+}  // namespace util
+}  // namespace veles
@@ -0,0 +1,351 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "util/sampling/entropy.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace veles {
+namespace util {
+
+static std::vector<uint8_t> randomData(size_t size) {
+  std::vector<uint8_t> data(size);
+  std::default_random_engine generator;
+  std::uniform_int_distribution<int> distribution(0, 255);
+  for (size_t i = 0; i < size; ++i) {
+    // Alternate between random, low-entropy and constant regions.
+    switch (i / 1000 % 3) {
+    case 0: data[i] = distribution(generator); break;
+    case 1: data[i] = distribution(generator) & 0x3; break;
+    default: data[i] = 0x42;
+    }
+  }
+  return data;
+}
+
+static float histogramEntropy(const uint64_t *counts, size_t count) {
+  float entropy = 0.0f;
+  for (int i = 0; i < 256; ++i) {
+    if (counts[i] > 0) {
+      float fcounts = static_cast<float>(counts[i]) / count;
+      entropy -= fcounts * log2(fcounts);
+    }
+  }
+  return entropy;
+}
+
+// The straightforward per point computation, which entropyPerPoint() has to
+// agree with.
+static std::vector<float> referencePerPoint(const std::vector<uint8_t> &data,
+                                            size_t points,
+                                            double point_size) {
+  std::vector<float> out(points);
+  uint64_t counts[256] = {0};
+  size_t index = 0, point_count = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    counts[data[i]] += 1;
+    point_count += 1;
+    if (static_cast<double>(i) / point_size >= index + 1) {
+      if (index == points - 1 && i < data.size() - 1) continue;
+      out[index] = histogramEntropy(counts, point_count);
+      index += 1;
+      point_count = 0;
+      memset(counts, 0, sizeof(counts));
+    }
+  }
+  return out;
+}
+
+static std::vector<float> referenceSliding(const std::vector<uint8_t> &data,
+                                           size_t points, double point_size,
+                                           size_t window) {
+  std::vector<float> out(points);
+  uint64_t counts[256] = {0};
+  size_t start = 0, end = 0;
+  while (start < data.size()) {
+    size_t mid = (start + end) / 2;
+    if (mid > 0 && std::floor(mid / point_size) !=
+        std::floor((mid - 1) / point_size)) {
+      out[static_cast<size_t>(mid / point_size)] =
+          histogramEntropy(counts, end - start);
+    }
+    if (end > window || end >= data.size()) {
+      counts[data[start++]] -= 1;
+    }
+    if (end < data.size()) {
+      counts[data[end++]] += 1;
+    }
+  }
+  return out;
+}
+
+TEST(Entropy, countBytes) {
+  auto data = randomData(10001);
+  uint64_t counts[256] = {0}, expected[256] = {0};
+  for (auto byte : data) {
+    expected[byte] += 1;
+  }
+  countBytes(data.data(), data.size(), counts);
+  for (int i = 0; i < 256; ++i) {
+    EXPECT_EQ(counts[i], expected[i]);
+  }
+
+  NLogNTable table(16);
+  EXPECT_NEAR(entropy(counts, data.size(), table),
+              histogramEntropy(expected, data.size()), 1e-4);
+  uint64_t uniform[256];
+  for (int i = 0; i < 256; ++i) {
+    uniform[i] = 3;
+  }
+  EXPECT_NEAR(entropy(uniform, 768, table), 8.0, 1e-9);
+  EXPECT_EQ(entropy(uniform, 0, table), 0.0);
+}
+
+TEST(Entropy, slidingEntropy) {
+  auto data = randomData(5000);
+  SlidingEntropy sliding(300);
+  uint64_t counts[256] = {0};
+  for (size_t i = 0; i < data.size(); ++i) {
+    sliding.push(data[i]);
+    counts[data[i]] += 1;
+    if (i >= 300) {
+      sliding.pop(data[i - 300]);
+      counts[data[i - 300]] -= 1;
+    }
+    ASSERT_EQ(sliding.size(), std::min<size_t>(i + 1, 300));
+    ASSERT_NEAR(sliding.entropy(), histogramEntropy(counts, sliding.size()),
+                1e-4);
+  }
+}
+
+TEST(Entropy, perPointMatchesReference) {
+  auto data = randomData(100000);
+  for (double point_size : {1.0, 3.7, 256.0, 1000.5, 33333.3}) {
+    size_t points = static_cast<size_t>(data.size() / point_size);
+    std::vector<float> out(points);
+    entropyPerPoint(data.data(), data.size(), point_size, points,
+                    out.data());
+    auto expected = referencePerPoint(data, points, point_size);
+    for (size_t i = 0; i < points; ++i) {
+      ASSERT_NEAR(out[i], expected[i], 1e-4) << point_size << " " << i;
+    }
+  }
+}
+
+TEST(Entropy, slidingPerPointMatchesReference) {
+  auto data = randomData(100000);
+  for (double point_size : {1.0, 2.5, 64.0, 255.9}) {
+    size_t points = static_cast<size_t>(std::ceil(data.size() / point_size));
+    std::vector<float> out(points);
+    slidingEntropyPerPoint(data.data(), data.size(), point_size, 256,
+                           out.data());
+    auto expected = referenceSliding(data, points, point_size, 256);
+    for (size_t i = 0; i < points; ++i) {
+      ASSERT_NEAR(out[i], expected[i], 1e-4) << point_size << " " << i;
+    }
+  }
+}
+
+TEST(Entropy, averagePerPoint) {
+  auto data = randomData(100000);
+  double point_size = 777.7;
+  size_t points = static_cast<size_t>(data.size() / point_size);
+  std::vector<float> out(points);
+  averagePerPoint(data.data(), data.size(), point_size, points, out.data());
+
+  std::vector<float> expected(points);
+  uint64_t point_sum = 0, point_count = 0;
+  size_t index = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    point_sum += data[i];
+    point_count += 1;
+    if (static_cast<double>(i) / point_size >= index + 1) {
+      if (index == points - 1 && i < data.size() - 1) continue;
+      expected[index] = static_cast<uint8_t>(point_sum / point_count);
+      index += 1;
+      point_sum = 0;
+      point_count = 0;
+    }
+  }
+  EXPECT_EQ(out, expected);
+}
+
+// ByteStats computed directly from their definitions.
+static ByteStats referenceStats(const uint8_t *data, size_t size) {
+  ByteStats stats = ByteStats();
+  uint64_t counts[256] = {0}, sum = 0;
+  for (size_t i = 0; i < size; ++i) {
+    counts[data[i]] += 1;
+    sum += data[i];
+    stats.printable += isprint(data[i]) || data[i] == '\t' ||
+                       data[i] == '\n' || data[i] == '\r';
+    stats.zeros += data[i] == 0;
+  }
+  stats.average = static_cast<uint8_t>(sum / size);
+  stats.entropy = histogramEntropy(counts, size);
+  stats.printable /= size;
+  stats.zeros /= size;
+  double expected = size / 256.0, chi_square = 0.0;
+  for (int i = 0; i < 256; ++i) {
+    chi_square += (counts[i] - expected) * (counts[i] - expected) / expected;
+  }
+  stats.chi_square = chi_square / (255.0 * size);
+  return stats;
+}
+
+static void expectStatsNear(const ByteStats &stats, const ByteStats &expected) {
+  EXPECT_EQ(stats.average, expected.average);
+  EXPECT_NEAR(stats.entropy, expected.entropy, 1e-4);
+  EXPECT_NEAR(stats.printable, expected.printable, 1e-6);
+  EXPECT_NEAR(stats.zeros, expected.zeros, 1e-6);
+  EXPECT_NEAR(stats.chi_square, expected.chi_square, 1e-5);
+}
+
+TEST(Entropy, byteStats) {
+  NLogNTable table(16);
+  uint64_t counts[256] = {0};
+  ByteStats empty = byteStats(counts, 0, table);
+  EXPECT_EQ(empty.entropy, 0.0f);
+  EXPECT_EQ(empty.chi_square, 0.0f);
+
+  auto data = randomData(3000);
+  countBytes(data.data(), data.size(), counts);
+  expectStatsNear(byteStats(counts, data.size(), table),
+                  referenceStats(data.data(), data.size()));
+
+  std::vector<uint8_t> constant(1000, 0);
+  ByteStats zeros = referenceStats(constant.data(), constant.size());
+  EXPECT_FLOAT_EQ(zeros.zeros, 1.0f);
+  EXPECT_FLOAT_EQ(zeros.printable, 0.0f);
+  EXPECT_FLOAT_EQ(zeros.chi_square, 1.0f);
+  std::vector<uint8_t> text(1024);
+  for (size_t i = 0; i < text.size(); ++i) {
+    text[i] = "Hello, world!\n"[i % 14];
+  }
+  memset(counts, 0, sizeof(counts));
+  countBytes(text.data(), text.size(), counts);
+  EXPECT_FLOAT_EQ(byteStats(counts, text.size(), table).printable, 1.0f);
+  for (int i = 0; i < 256; ++i) {
+    counts[i] = 4;
+  }
+  EXPECT_FLOAT_EQ(byteStats(counts, 1024, table).chi_square, 0.0f);
+}
+
+TEST(Entropy, slidingStats) {
+  auto data = randomData(5000);
+  SlidingStats sliding(300);
+  for (size_t i = 0; i < data.size(); ++i) {
+    sliding.push(data[i]);
+    if (i >= 300) {
+      sliding.pop(data[i - 300]);
+    }
+    ASSERT_EQ(sliding.size(), std::min<size_t>(i + 1, 300));
+    if (i % 100 == 0) {
+      size_t start = i + 1 - sliding.size();
+      ByteStats expected = referenceStats(data.data() + start, sliding.size());
+      expected.average = 0;
+      expectStatsNear(sliding.stats(), expected);
+    }
+  }
+}
+
+TEST(Entropy, statsPerPoint) {
+  auto data = randomData(100000);
+  for (double point_size : {3.7, 1000.5}) {
+    size_t points = static_cast<size_t>(data.size() / point_size);
+    std::vector<ByteStats> out(points);
+    statsPerPoint(data.data(), data.size(), point_size, points, out.data());
+    std::vector<float> entropies(points), averages(points);
+    entropyPerPoint(data.data(), data.size(), point_size, points,
+                    entropies.data());
+    averagePerPoint(data.data(), data.size(), point_size, points,
+                    averages.data());
+    for (size_t i = 0; i < points; ++i) {
+      ASSERT_NEAR(out[i].entropy, entropies[i], 1e-4) << point_size << " " << i;
+      ASSERT_EQ(out[i].average, averages[i]) << point_size << " " << i;
+    }
+    // Point 50 takes the bytes after the first one reaching 50, up to the
+    // first one reaching 51.
+    size_t start = static_cast<size_t>(std::ceil(50 * point_size));
+    size_t end = static_cast<size_t>(std::ceil(51 * point_size));
+    expectStatsNear(out[50], referenceStats(data.data() + start + 1,
+                                            end - start));
+  }
+}
+
+TEST(Entropy, slidingStatsPerPoint) {
+  auto data = randomData(100000);
+  for (double point_size : {1.0, 64.0, 255.9}) {
+    size_t points = static_cast<size_t>(std::ceil(data.size() / point_size));
+    std::vector<ByteStats> out(points);
+    slidingStatsPerPoint(data.data(), data.size(), point_size, points, 256,
+                         out.data());
+    std::vector<float> entropies(points), averages(points);
+    slidingEntropyPerPoint(data.data(), data.size(), point_size, 256,
+                           entropies.data());
+    averagePerPoint(data.data(), data.size(), point_size, points,
+                    averages.data());
+    for (size_t i = 0; i < points; ++i) {
+      ASSERT_NEAR(out[i].entropy, entropies[i], 1e-6) << point_size << " " << i;
+      ASSERT_EQ(out[i].average, averages[i]) << point_size << " " << i;
+    }
+  }
+}
+
+// Computing the points in ranges (as done in parallel) gives the same
+// result as computing them all at once.
+TEST(Entropy, pointRanges) {
+  auto data = randomData(100000);
+  for (double point_size : {1.0, 7.3, 300.0}) {
+    size_t points = static_cast<size_t>(std::ceil(data.size() / point_size));
+    std::vector<float> whole(points), parts(points);
+    std::vector<float> sliding_whole(points), sliding_parts(points);
+    entropyPerPoint(data.data(), data.size(), point_size, points,
+                    whole.data());
+    slidingEntropyPerPoint(data.data(), data.size(), point_size, 256,
+                           sliding_whole.data());
+    for (size_t first = 0; first < points; first += 1000) {
+      size_t last = std::min(points, first + 1000);
+      entropyPerPoint(data.data(), data.size(), point_size, points,
+                      parts.data(), first, last);
+      slidingEntropyPerPoint(data.data(), data.size(), point_size, 256,
+                             sliding_parts.data(), first, last);
+    }
+    EXPECT_EQ(whole, parts) << point_size;
+    EXPECT_EQ(sliding_whole, sliding_parts) << point_size;
+
+    std::vector<ByteStats> stats_whole(points), stats_parts(points);
+    slidingStatsPerPoint(data.data(), data.size(), point_size, points, 256,
+                         stats_whole.data());
+    for (size_t first = 0; first < points; first += 1000) {
+      size_t last = std::min(points, first + 1000);
+      slidingStatsPerPoint(data.data(), data.size(), point_size, points, 256,
+                           stats_parts.data(), first, last);
+    }
+    for (size_t i = 0; i < points; ++i) {
+      ASSERT_EQ(memcmp(&stats_whole[i], &stats_parts[i], sizeof(ByteStats)),
+                0) << point_size << " " << i;
+    }
+  }
+}
+
+}  // namespace util
+}  // namespace veles
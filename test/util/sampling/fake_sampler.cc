@@ -0,0 +1,124 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "util/sampling/fake_sampler.h"
+
+#include <memory>
+
+namespace veles {
+namespace util {
+
+TEST(FakeSampler, sharesData) {
+  data::BinData data(8, 0x10000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, i & 0xff);
+  }
+  const data::BinData &cdata = data;
+  FakeSampler sampler(data);
+  sampler.setSampleSize(data.size());
+  EXPECT_EQ(sampler.getSampleSize(), 0xffff);
+  EXPECT_EQ(reinterpret_cast<const uint8_t *>(sampler.data()), cdata.rawData());
+  EXPECT_EQ(sampler[0x1234], 0x34);
+
+  // The sampler keeps its own view, unaffected by changes to the original.
+  data.setElement64(0x1234, 0xaa);
+  EXPECT_EQ(sampler[0x1234], 0x34);
+  std::unique_ptr<ISampler> clone(sampler.clone());
+  data = data::BinData();
+  EXPECT_EQ((*clone)[0x1234], 0x34);
+}
+
+TEST(FakeSampler, pieces) {
+  data::BinData data(8, 0x10000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, i & 0xff);
+  }
+  const data::BinData &cdata = data;
+  data::PieceTable table(data);
+  table.replace(0x8000, 0x8001, data::BinData(8, {0xaa}));
+  ASSERT_EQ(table.pieceCount(), 3);
+
+  FakeSampler sampler(table);
+  sampler.setSampleSize(table.size());
+  EXPECT_EQ(sampler[0x7fff], static_cast<char>(0xff));
+  EXPECT_EQ(sampler[0x8000], static_cast<char>(0xaa));
+  EXPECT_EQ(sampler[0x8001], 0x01);
+  // The range spans three pieces, so it has to be copied.
+  const char *all = sampler.data();
+  EXPECT_NE(reinterpret_cast<const uint8_t *>(all), cdata.rawData());
+  EXPECT_EQ(all[0x8000], static_cast<char>(0xaa));
+  EXPECT_EQ(all[0x9000], 0x00);
+
+  // A range within a single piece is used in place.
+  sampler.setRange(0x9000, 0xa000);
+  EXPECT_EQ(reinterpret_cast<const uint8_t *>(sampler.data()),
+            cdata.rawData(0x9000));
+}
+
+TEST(FakeSampler, setData) {
+  data::BinData data(8, 0x1000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, i & 0xff);
+  }
+  data::PieceTable table(data);
+  FakeSampler sampler(table);
+  sampler.setSampleSize(table.size());
+  sampler.setRange(0x100, 0x200);
+  EXPECT_EQ(sampler[0x10], 0x10);
+
+  table.replace(0x110, 0x111, data::BinData(8, {0xaa}));
+  sampler.setData(table);
+  EXPECT_EQ(sampler.getRange().first, 0x100);
+  EXPECT_EQ(sampler[0x10], static_cast<char>(0xaa));
+  EXPECT_EQ(sampler.data()[0x10], static_cast<char>(0xaa));
+}
+
+TEST(FakeSampler, elementWidth) {
+  data::BinData data(16, 0x1000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, i * 0x10);
+  }
+  FakeSampler sampler(data);
+  sampler.setSampleSize(data.size());
+  EXPECT_EQ(sampler.getSampleSize(), 0xfff);
+  // 16-bit elements are reduced to their high bytes.
+  EXPECT_EQ(sampler[0x123], 0x12);
+  EXPECT_EQ(sampler.data()[0xff0], static_cast<char>(0xff));
+}
+
+TEST(FakeSampler, repackedRange) {
+  data::BinData data(8, 0x6000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, (i * 0x9d + 0x31) & 0xff);
+  }
+  data::RepackFormat format{data::RepackEndian::BIG, 12};
+  data::BinData elements = data::repack(data, format, 0, 0x4000);
+
+  // The whole range is normalized at once, over many repacking batches.
+  FakeSampler sampler(data);
+  sampler.setElementFormat(format);
+  sampler.setRange(0x3, 0x3ffd);
+  sampler.setSampleSize(0x4000);
+  ASSERT_EQ(sampler.getSampleSize(), 0x3ffa);
+  const char *sample = sampler.data();
+  for (size_t i = 0; i < 0x3ffa; ++i) {
+    ASSERT_EQ(sample[i], static_cast<char>(elements.element64(0x3 + i) >> 4));
+  }
+}
+
+}  // namespace util
+}  // namespace veles
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "util/sampling/importance_sampler.h"
+
+namespace veles {
+namespace util {
+
+TEST(ImportanceSampler, prefersHighEntropy) {
+  // 1MB of zeros with 64kB of noise in the middle.
+  data::BinData data(8, 0x100000);
+  const size_t noise_start = 0x80000, noise_end = 0x90000;
+  uint32_t x = 1;
+  for (size_t i = noise_start; i < noise_end; ++i) {
+    x = x * 1103515245 + 12345;
+    data.setElement64(i, x >> 24);
+  }
+  ImportanceSampler sampler(data);
+  sampler.setSampleSize(0x4000);
+  size_t size = sampler.getSampleSize();
+  EXPECT_LE(size, 0x4000);
+  EXPECT_GT(size, 0x3000);
+
+  // The noise is 1/16 of the input, but should get a big part of the sample.
+  size_t noise = 0;
+  for (size_t i = 0; i < size; ++i) {
+    size_t offset = sampler.getFileOffset(i);
+    if (offset >= noise_start && offset < noise_end) {
+      ++noise;
+    }
+  }
+  EXPECT_GT(noise, size / 2);
+  // ... but the zeros are still sampled.
+  EXPECT_GT(size - noise, size / 16);
+}
+
+TEST(ImportanceSampler, offsets) {
+  data::BinData data(8, 0x100000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, (i * i) >> 11);
+  }
+  ImportanceSampler sampler(data);
+  sampler.setSampleSize(0x4000);
+  sampler.setRange(0x1000, 0xf0000);
+  const char *sample = sampler.data();
+  size_t size = sampler.getSampleSize();
+  size_t previous = 0;
+  for (size_t i = 1; i < size - 1; ++i) {
+    size_t offset = sampler.getFileOffset(i);
+    EXPECT_GT(offset, previous);
+    EXPECT_EQ(sample[i], static_cast<char>(data.element64(offset)));
+    EXPECT_EQ(sampler.getSampleOffset(offset), i);
+    previous = offset;
+  }
+}
+
+}  // namespace util
+}  // namespace veles
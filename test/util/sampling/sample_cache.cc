@@ -0,0 +1,105 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "util/sampling/sample_cache.h"
+#include "util/sampling/uniform_sampler.h"
+
+#include <memory>
+
+namespace veles {
+namespace util {
+
+static SampleCache::Key key(size_t start) {
+  return SampleCache::Key{nullptr, 0x1000, false, data::RepackEndian::LITTLE,
+                          0, 0, 0, start, start + 0x100, 0x10, 4, 0, 0};
+}
+
+static std::shared_ptr<const SampleCache::Sample> sample(size_t size) {
+  std::shared_ptr<const char> data(new char[size],
+                                   std::default_delete<char[]>());
+  return std::make_shared<SampleCache::Sample>(
+      SampleCache::Sample{std::vector<size_t>(), data, size});
+}
+
+TEST(SampleCache, evictsLeastRecentlyUsed) {
+  SampleCache cache(0x300);
+  data::BinData input;
+  cache.insert(key(0), input, sample(0x100));
+  cache.insert(key(1), input, sample(0x100));
+  cache.insert(key(2), input, sample(0x100));
+  EXPECT_EQ(cache.size(), 0x300);
+  // Touch the oldest one, so that key(1) goes first.
+  EXPECT_NE(cache.find(key(0)), nullptr);
+  cache.insert(key(3), input, sample(0x100));
+  EXPECT_EQ(cache.size(), 0x300);
+  EXPECT_NE(cache.find(key(0)), nullptr);
+  EXPECT_EQ(cache.find(key(1)), nullptr);
+  EXPECT_NE(cache.find(key(2)), nullptr);
+  EXPECT_NE(cache.find(key(3)), nullptr);
+
+  // Too big to be cached at all.
+  cache.insert(key(4), input, sample(0x400));
+  EXPECT_EQ(cache.find(key(4)), nullptr);
+  EXPECT_EQ(cache.size(), 0x300);
+
+  cache.setMaxSize(0x100);
+  EXPECT_EQ(cache.size(), 0x100);
+  EXPECT_NE(cache.find(key(3)), nullptr);
+  cache.clear();
+  EXPECT_EQ(cache.size(), 0);
+  EXPECT_EQ(cache.find(key(3)), nullptr);
+}
+
+TEST(SampleCache, formatFields) {
+  SampleCache cache;
+  data::BinData input;
+  // Used to share an entry, when the format was packed into one integer.
+  SampleCache::Key low = key(0), high = key(0);
+  low.repack = high.repack = true;
+  low.width = high.width = 8;
+  low.low_pad = 1 << 20;
+  high.high_pad = 1;
+  cache.insert(low, input, sample(0x100));
+  EXPECT_NE(cache.find(low), nullptr);
+  EXPECT_EQ(cache.find(high), nullptr);
+  EXPECT_EQ(cache.find(key(0)), nullptr);
+}
+
+TEST(SampleCache, sharedBetweenClones) {
+  data::BinData data(8, 0x100000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, i * 0x5b);
+  }
+  auto cache = std::make_shared<SampleCache>();
+  UniformSampler sampler(data);
+  sampler.setSampleSize(0x1000);
+  sampler.setCache(cache);
+  sampler.setRange(0x1000, 0x80000);
+  const char *sample = sampler.data();
+  EXPECT_GT(cache->size(), 0);
+
+  std::unique_ptr<ISampler> clone(sampler.clone());
+  clone->setRange(0x2000, 0x90000);
+  EXPECT_NE(clone->data(), sample);
+  // Going back to the first range reuses its sample.
+  clone->setRange(0x1000, 0x80000);
+  EXPECT_EQ(clone->data(), sample);
+  EXPECT_EQ(clone->getFileOffset(0x800), sampler.getFileOffset(0x800));
+}
+
+}  // namespace util
+}  // namespace veles
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "util/sampling/stats_pyramid.h"
+
+#include <random>
+
+namespace veles {
+namespace util {
+
+static data::BinData randomData(unsigned width, size_t size) {
+  data::BinData data(width, size);
+  std::default_random_engine generator;
+  std::uniform_int_distribution<uint64_t> distribution;
+  for (size_t i = 0; i < size; ++i) {
+    // Skew the values, so that ranges differ in entropy.
+    uint64_t value = distribution(generator);
+    data.setElement64(i, i % 3 == 0 ? value : value & 0x0f0f0f0f0f0f0f0f);
+  }
+  return data;
+}
+
+static void expectExact(const StatsPyramid &pyramid,
+                        const data::BinData &data, size_t start, size_t end) {
+  uint64_t histogram[256] = {0};
+  uint64_t sum = 0;
+  for (size_t i = start; i < end; ++i) {
+    uint8_t value = data.element64(i) >> (data.width() - 8);
+    histogram[value] += 1;
+    sum += value;
+  }
+  auto stats = pyramid.query(start, end);
+  EXPECT_EQ(stats.count, end - start);
+  EXPECT_EQ(stats.sum, sum);
+  for (int i = 0; i < 256; ++i) {
+    EXPECT_EQ(stats.histogram[i], histogram[i]);
+  }
+  auto sums = pyramid.query(start, end, false);
+  EXPECT_EQ(sums.count, end - start);
+  EXPECT_EQ(sums.sum, sum);
+}
+
+TEST(StatsPyramid, matchesBruteForce) {
+  auto data = randomData(8, 10000);
+  StatsPyramid pyramid(data, 64);
+  EXPECT_FALSE(pyramid.ready());
+  EXPECT_TRUE(pyramid.build());
+  EXPECT_TRUE(pyramid.ready());
+
+  expectExact(pyramid, data, 0, 10000);
+  expectExact(pyramid, data, 0, 0);
+  expectExact(pyramid, data, 10, 50);
+  expectExact(pyramid, data, 64, 128);
+  expectExact(pyramid, data, 63, 9999);
+  expectExact(pyramid, data, 1000, 10000);
+  std::default_random_engine generator;
+  std::uniform_int_distribution<size_t> offset(0, 10000);
+  for (int i = 0; i < 100; ++i) {
+    size_t start = offset(generator), end = offset(generator);
+    expectExact(pyramid, data, std::min(start, end), std::max(start, end));
+  }
+}
+
+TEST(StatsPyramid, wideElements) {
+  auto data = randomData(16, 3000);
+  StatsPyramid pyramid(data, 100);
+  EXPECT_TRUE(pyramid.build());
+  expectExact(pyramid, data, 0, 3000);
+  expectExact(pyramid, data, 150, 2950);
+}
+
+TEST(StatsPyramid, alignOffset) {
+  auto data = randomData(8, 1000);
+  StatsPyramid pyramid(data, 64);
+  EXPECT_EQ(pyramid.getBlockSize(), 64);
+  EXPECT_EQ(pyramid.alignOffset(0), 0);
+  EXPECT_EQ(pyramid.alignOffset(31), 0);
+  EXPECT_EQ(pyramid.alignOffset(32), 64);
+  EXPECT_EQ(pyramid.alignOffset(999), 1000);
+
+  StatsPyramid large(data::BinData(
+      8, StatsPyramid::MIN_BLOCK_SIZE * StatsPyramid::MAX_BLOCKS + 1));
+  EXPECT_EQ(large.getBlockSize(), 2 * StatsPyramid::MIN_BLOCK_SIZE);
+  StatsPyramid small(data);
+  EXPECT_EQ(small.getBlockSize(), StatsPyramid::MIN_BLOCK_SIZE);
+}
+
+TEST(StatsPyramid, entropy) {
+  data::BinData data(8, 512);
+  for (size_t i = 0; i < 512; ++i) {
+    data.setElement64(i, i < 256 ? 7 : i);
+  }
+  StatsPyramid pyramid(data, 16);
+  EXPECT_TRUE(pyramid.build());
+  EXPECT_DOUBLE_EQ(pyramid.query(0, 256).entropy(), 0.0);
+  EXPECT_DOUBLE_EQ(pyramid.query(256, 512).entropy(), 8.0);
+  EXPECT_DOUBLE_EQ(pyramid.query(0, 256).average(), 7.0);
+  EXPECT_DOUBLE_EQ(pyramid.query(0, 0).average(), 0.0);
+}
+
+TEST(StatsPyramid, update) {
+  auto data = randomData(8, 10000);
+  StatsPyramid pyramid(data, 64);
+  EXPECT_FALSE(pyramid.update(data, 0, 1));
+  EXPECT_TRUE(pyramid.build());
+
+  // The old data keeps its contents, as copies only share storage until
+  // modified.
+  data::BinData edited = data;
+  edited.setElement64(5000, 0xff);
+  for (size_t i = 6300; i < 6500; ++i) {
+    edited.setElement64(i, 0);
+  }
+  EXPECT_TRUE(pyramid.update(edited, 5000, 5001));
+  EXPECT_TRUE(pyramid.update(edited, 6300, 6500));
+  expectExact(pyramid, edited, 0, 10000);
+  expectExact(pyramid, edited, 4990, 5010);
+  expectExact(pyramid, edited, 6000, 7000);
+  expectExact(pyramid, edited, 5000, 6400);
+
+  edited.setElement64(9999, 1);
+  EXPECT_TRUE(pyramid.update(edited, 9999, 20000));
+  expectExact(pyramid, edited, 0, 10000);
+  expectExact(pyramid, edited, 9990, 10000);
+
+  EXPECT_FALSE(pyramid.update(randomData(8, 10001), 0, 10001));
+  EXPECT_FALSE(pyramid.update(randomData(16, 10000), 0, 10000));
+  expectExact(pyramid, edited, 0, 10000);
+}
+
+TEST(StatsPyramid, pieces) {
+  for (unsigned width : {8, 16}) {
+    data::PieceTable table(randomData(width, 10000));
+    table.replace(100, 200, randomData(width, 50));
+    table.replace(5000, 5000, randomData(width, 3000));
+    ASSERT_GE(table.pieceCount(), 3);
+    StatsPyramid pyramid(table, 64);
+    EXPECT_TRUE(pyramid.build());
+    data::BinData flat = table.data();
+    expectExact(pyramid, flat, 0, flat.size());
+    expectExact(pyramid, flat, 90, 5100);
+    expectExact(pyramid, flat, 4999, 8001);
+
+    // Edits of the table are applied without copying its data.
+    table.replace(4990, 5010, randomData(width, 20));
+    EXPECT_TRUE(pyramid.update(table, 4990, 5010));
+    flat = table.data();
+    expectExact(pyramid, flat, 0, flat.size());
+    expectExact(pyramid, flat, 4900, 5100);
+  }
+}
+
+TEST(StatsPyramid, cancel) {
+  auto data = randomData(8, 1000);
+  StatsPyramid pyramid(data, 64);
+  std::atomic<bool> cancelled(true);
+  EXPECT_FALSE(pyramid.build(&cancelled));
+  EXPECT_FALSE(pyramid.ready());
+}
+
+}  // namespace util
+}  // namespace veles
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "util/sampling/streaming_sampler.h"
+
+namespace veles {
+namespace util {
+
+TEST(StreamingSampler, sample) {
+  data::BinData data(8, 0x400000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, (i * i) >> 11);
+  }
+  StreamingSampler sampler(data);
+  sampler.setSampleSize(0x10000);
+  sampler.setRange(0x1000, 0x3ff000);
+  const char *sample = sampler.data();
+  size_t size = sampler.getSampleSize();
+  EXPECT_EQ(size, 0x10000);
+
+  size_t previous = 0, first_half = 0;
+  for (size_t i = 1; i < size - 1; ++i) {
+    size_t offset = sampler.getFileOffset(i);
+    EXPECT_GT(offset, previous);
+    EXPECT_EQ(sample[i], static_cast<char>(data.element64(offset)));
+    EXPECT_EQ(sampler.getSampleOffset(offset), i);
+    if (offset < 0x200000) {
+      ++first_half;
+    }
+    previous = offset;
+  }
+  // Windows are spread uniformly over the whole range.
+  EXPECT_GT(first_half, size * 2 / 5);
+  EXPECT_LT(first_half, size * 3 / 5);
+}
+
+}  // namespace util
+}  // namespace veles
@@ -0,0 +1,250 @@
+/*
+ * Copyright 2016 CodiLime
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include "gtest/gtest.h"
+#include "data/repack.h"
+#include "util/sampling/uniform_sampler.h"
+
+#include <cstring>
+#include <memory>
+#include <set>
+
+namespace veles {
+namespace util {
+
+TEST(UniformSampler, progressivePasses) {
+  data::BinData data(8, 0x400000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, (i * 0x9e3779b1) >> 13);
+  }
+  UniformSampler full(data);
+  full.setSampleSize(0x100000);
+  EXPECT_EQ(full.getPassesCount(), 1);
+
+  UniformSampler progressive(data);
+  progressive.setSampleSize(0x100000);
+  progressive.setProgressive(true);
+  // 1024 windows of 1024 bytes, the first pass takes 64 of them.
+  size_t passes = progressive.getPassesCount();
+  ASSERT_EQ(passes, 5);
+
+  std::set<size_t> previous;
+  for (size_t pass = 0; pass < passes; ++pass) {
+    std::unique_ptr<ISampler> sampler(progressive.clone());
+    sampler->setPass(pass);
+    size_t size = sampler->getSampleSize();
+    EXPECT_EQ(size, 0x400 * (0x40 << pass));
+    std::set<size_t> windows;
+    for (size_t i = 0x400; i < size; i += 0x400) {
+      windows.insert(sampler->getFileOffset(i));
+    }
+    for (size_t window : previous) {
+      EXPECT_EQ(windows.count(window), 1);
+    }
+    previous = windows;
+    if (pass == passes - 1) {
+      ASSERT_EQ(size, full.getSampleSize());
+      EXPECT_EQ(std::memcmp(sampler->data(), full.data(), size), 0);
+    }
+  }
+}
+
+static std::set<size_t> windowOffsets(ISampler *sampler, size_t window_size) {
+  std::set<size_t> windows;
+  for (size_t i = window_size; i < sampler->getSampleSize(); i += window_size) {
+    windows.insert(sampler->getFileOffset(i));
+  }
+  return windows;
+}
+
+TEST(UniformSampler, seed) {
+  data::BinData data(8, 0x100000);
+  UniformSampler sampler(data);
+  sampler.setSampleSize(0x10000);
+  auto windows = windowOffsets(&sampler, 0x100);
+  std::unique_ptr<ISampler> clone(sampler.clone());
+  EXPECT_EQ(windowOffsets(clone.get(), 0x100), windows);
+  clone->setSeed(1234);
+  auto seeded = windowOffsets(clone.get(), 0x100);
+  EXPECT_NE(seeded, windows);
+  sampler.setSeed(1234);
+  EXPECT_EQ(windowOffsets(&sampler, 0x100), seeded);
+}
+
+TEST(UniformSampler, incremental) {
+  data::BinData data(8, 0x400000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, (i * i) >> 11);
+  }
+  UniformSampler sampler(data);
+  sampler.setSampleSize(0x10000);
+  sampler.setIncremental(true);
+  sampler.data();
+  auto windows = windowOffsets(&sampler, 0x100);
+
+  sampler.setRange(0x100000, 0x300000);
+  const char *sample = sampler.data();
+  size_t size = sampler.getSampleSize();
+  EXPECT_EQ(size, 0x10000);
+  auto topped_up = windowOffsets(&sampler, 0x100);
+  for (size_t window : windows) {
+    if (window >= 0x100000 && window + 0x100 <= 0x300000) {
+      EXPECT_EQ(topped_up.count(window), 1);
+    }
+  }
+  size_t previous = 0;
+  for (size_t i = 1; i < size - 1; ++i) {
+    size_t offset = sampler.getFileOffset(i);
+    EXPECT_GT(offset, previous);
+    EXPECT_GE(offset, 0x100000);
+    EXPECT_LT(offset, 0x300000);
+    EXPECT_EQ(sample[i], static_cast<char>(data.element64(offset)));
+    previous = offset;
+  }
+
+  // The same sequence of ranges gives the same sample.
+  UniformSampler again(data);
+  again.setSampleSize(0x10000);
+  again.setIncremental(true);
+  again.data();
+  again.setRange(0x100000, 0x300000);
+  EXPECT_EQ(windowOffsets(&again, 0x100), topped_up);
+}
+
+TEST(UniformSampler, incrementalClone) {
+  data::BinData data(8, 0x400000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, (i * i) >> 11);
+  }
+  UniformSampler sampler(data);
+  sampler.setSampleSize(0x10000);
+  sampler.setIncremental(true);
+  const char *sample = sampler.data();
+  auto windows = windowOffsets(&sampler, 0x100);
+
+  // A new selection in VisualisationPanel: the clone of the displayed
+  // sampler gets the new range, the displayed one stays as it was.
+  std::unique_ptr<ISampler> clone(sampler.clone());
+  clone->setSampleSize(0x10000);
+  clone->setRange(0x100000, 0x300000);
+  const char *topped_up_sample = clone->data();
+  size_t size = clone->getSampleSize();
+  EXPECT_EQ(size, 0x10000);
+  auto topped_up = windowOffsets(clone.get(), 0x100);
+  size_t kept = 0;
+  for (size_t window : windows) {
+    if (window >= 0x100000 && window + 0x100 <= 0x300000) {
+      EXPECT_EQ(topped_up.count(window), 1);
+      ++kept;
+    }
+  }
+  EXPECT_GT(kept, 0);
+  // Kept windows are copied from the shared sample, not read again.
+  EXPECT_EQ(clone->getStats().bytes_read, size - kept * 0x100);
+  EXPECT_EQ(sampler.data(), sample);
+  EXPECT_EQ(windowOffsets(&sampler, 0x100), windows);
+
+  // Same as narrowing the range of the sampler itself.
+  sampler.setRange(0x100000, 0x300000);
+  EXPECT_EQ(windowOffsets(&sampler, 0x100), topped_up);
+  EXPECT_EQ(std::memcmp(sampler.data(), topped_up_sample, size), 0);
+}
+
+TEST(UniformSampler, setData) {
+  data::BinData data(8, 0x100000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, i >> 8);
+  }
+  data::PieceTable table(data);
+  UniformSampler sampler(table);
+  sampler.setSampleSize(0x10000);
+  sampler.setCache(std::make_shared<SampleCache>());
+  sampler.data();
+  auto windows = windowOffsets(&sampler, 0x100);
+  size_t edited = sampler.getFileOffset(0x1234);
+
+  table.replace(edited, edited + 1, data::BinData(8, {0xaa}));
+  sampler.setData(table);
+  // The windows are kept, only their contents are read again.
+  EXPECT_EQ(windowOffsets(&sampler, 0x100), windows);
+  EXPECT_EQ(sampler.getFileOffset(0x1234), edited);
+  const char *sample = sampler.data();
+  EXPECT_EQ(sample[0x1234], static_cast<char>(0xaa));
+  EXPECT_EQ(sample[0x1235], static_cast<char>((edited + 1) >> 8));
+  const SamplerStats &stats = sampler.getStats();
+  EXPECT_EQ(stats.initialisations, 1);
+  EXPECT_EQ(stats.bytes_read, 0x20000);
+
+  // The sample read again is cached as one of the new input.
+  std::unique_ptr<ISampler> clone(sampler.clone());
+  EXPECT_EQ(clone->data()[0x1234], static_cast<char>(0xaa));
+  EXPECT_EQ(clone->getStats().cache_hits, 1);
+}
+
+TEST(UniformSampler, stats) {
+  data::BinData data(8, 0x100000);
+  UniformSampler sampler(data);
+  sampler.setSampleSize(0x10000);
+  sampler.setCache(std::make_shared<SampleCache>());
+  sampler.data();
+  sampler.data();
+  const SamplerStats &stats = sampler.getStats();
+  EXPECT_EQ(stats.initialisations, 1);
+  EXPECT_EQ(stats.data_calls, 2);
+  EXPECT_EQ(stats.bytes_read, 0x10000);
+  EXPECT_EQ(stats.cache_hits, 0);
+  EXPECT_EQ(stats.cache_misses, 1);
+
+  sampler.setRange(0x1000, 0x80000);
+  sampler.data();
+  sampler.setRange(0, 0xfffff);
+  sampler.data();
+  EXPECT_EQ(stats.initialisations, 3);
+  EXPECT_EQ(stats.bytes_read, 0x20000);
+  EXPECT_EQ(stats.cache_hits, 1);
+  EXPECT_EQ(stats.cache_misses, 2);
+
+  std::unique_ptr<ISampler> clone(sampler.clone());
+  EXPECT_EQ(clone->getStats().initialisations, 0);
+  sampler.resetStats();
+  EXPECT_EQ(stats.data_calls, 0);
+}
+
+TEST(UniformSampler, repackedElements) {
+  // 12-bit big endian elements packed in bytes.
+  data::BinData data(8, 0x30000);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data.setElement64(i, (i * i) >> 7);
+  }
+  data::RepackFormat format{data::RepackEndian::BIG, 12, 0, 0};
+  data::BinData elements = data::repack(data, format, 0, 0x20000);
+
+  UniformSampler sampler(data);
+  sampler.setElementFormat(format);
+  sampler.setSampleSize(0x4000);
+  sampler.setRange(0x1000, 0x1f000);
+  const char *sample = sampler.data();
+  size_t size = sampler.getSampleSize();
+  EXPECT_EQ(size, 0x4000);
+  for (size_t i = 1; i < size - 1; ++i) {
+    size_t offset = sampler.getFileOffset(i);
+    EXPECT_LT(offset, 0x1f000);
+    EXPECT_EQ(sample[i], static_cast<char>(elements.element64(offset) >> 4));
+  }
+}
+
+}  // namespace util
+}  // namespace veles